@@ -71,6 +71,10 @@
 #include "vexprintf.h"
 #include "vexshell.h"
 #include "vexbkup.h"
+#include "vexboot.h"
+#include "vexperf.h"
+#include "vexisr.h"
+#include "vexstack.h"
 
 /**
  * @brief   ConVEX version string.
@@ -121,11 +125,49 @@
 #define SONAR_TASK_STACK_SIZE       0xD0
 #define LCD_TASK_STACK_SIZE         0xD0
 #define TEST_TASK_STACK_SIZE        0xD0
-#define SYSTEM_TASK_STACK_SIZE      0xD0
+#define SYSTEM_TASK_STACK_SIZE      0x1D0
 #define MONITOR_TASK_STACK_SIZE     0x1D0
 #define AUDIO_TASK_STACK_SIZE       0xD0
 /** @} */
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Run a function from RAM                                        */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Functions marked VEX_RAMTEXT are linked into the .ramtext section, which
+ *  is copied to RAM with the initialized data, when the project Makefile
+ *  sets USE_VEX_RAMTEXT = yes.  Flash runs with 2 wait states at 72MHz so
+ *  this is used for the interrupt handlers and the spi transfer.  Calls
+ *  between flash and RAM are out of range for a normal branch, long_call
+ *  covers callers that can see the attribute and the linker adds veneers
+ *  for the rest.
+ *  "make ramtextreport" shows what ended up in RAM.
+ */
+#if defined(VEX_RAMTEXT_ENABLE)
+#define VEX_RAMTEXT     __attribute__ ((section(".ramtext"), long_call, noinline))
+#else
+#define VEX_RAMTEXT
+#endif
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      System task period in mS, this is the spi update rate          */
+/*-----------------------------------------------------------------------------*/
+#define SYSTEM_TASK_PERIOD_MS       16
+
+/*-----------------------------------------------------------------------------*/
+/** @{                                                                         */
+/** @name Competition mode transitions                                         */
+/*-----------------------------------------------------------------------------*/
+/** @brief  How often the monitor task checks the competition flags            */
+#if !defined(VEX_MONITOR_POLL_MS)
+#define VEX_MONITOR_POLL_MS         2
+#endif
+/** @brief  Default time allowed for user threads to stop on a mode change     */
+#if !defined(VEX_TRANSITION_BUDGET_MS)
+#define VEX_TRANSITION_BUDGET_MS    50
+#endif
+/** @} */
+
 /*-----------------------------------------------------------------------------*/
 // Serial ports swap around depending on the board
 #ifdef  BOARD_OLIMEX_STM32_P103
@@ -163,6 +205,17 @@ void        vexTaskPersistentSet( Thread *tp, bool_t p );
 
 void        vexTaskEmergencyStop( void );
 void        vexSleep( int32_t msec );
+void        vexTaskSystemTick( void );
+
+void        vexTransitionBudgetSet( uint32_t ms );
+void        vexTransitionDebug(vexStream *chp, int argc, char *argv[]);
+
+/*-----------------------------------------------------------------------------*/
+// Functions called by the system task before every spi transfer
+typedef void (*vexTickCallback)( void );
+
+bool_t      vexSystemTickCallbackAdd( vexTickCallback cb );
+bool_t      vexSystemTickCallbackRemove( vexTickCallback cb );
 
 //#define     VEX_WATCHDOG_ENABLE     1
 void        vexWatchdogInit(void);
@@ -0,0 +1,245 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexboot.c                                                    */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Each stage of startup calls vexBootMark when it completes.  Tasks that  */
+/*    depend on a stage wait for it with vexBootWait rather than sleeping for  */
+/*    a fixed time, the mark broadcasts an event so waiters run immediately.  */
+/*    The time of each stage is kept and can be shown with vexBootDebug.      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexboot.c
+  * @brief   Boot sequencing and timing
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Event flag used by listeners waiting for a boot phase          */
+/*-----------------------------------------------------------------------------*/
+#define VEX_BOOT_EVENT      EVENT_MASK(4)
+
+/** @cond */
+static const char *vexBootNames[kVexBootPhaseNum] = {
+    "cortex init",
+    "spi init",
+    "adc init",
+    "lcd init",
+    "ime init",
+    "user setup",
+    "tasks started",
+    "master reset",
+    "spi online",
+    "ime ready",
+    "user init",
+    "user init done",
+    "gyro ready",
+    "first enable"
+};
+/** @endcond */
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Time each phase completed                                      */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    bool_t      done;
+    systime_t   time;           ///< system time in ticks
+    halrtcnt_t  cycles;         ///< cycle counter, for short phases
+    } vexBootPhase;
+
+static  vexBootPhase    vexBootPhases[kVexBootPhaseNum];
+static  EVENTSOURCE_DECL(boot_event);
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Mark a boot phase as complete                                  */
+/** @param[in]  phase the phase                                                */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Only the first call for each phase is recorded.  Must be called from a
+ *  thread, not an ISR.
+ */
+
+void
+vexBootMark( tVexBootPhase phase )
+{
+    if( phase >= kVexBootPhaseNum )
+        return;
+
+    chSysLock();
+    if( !vexBootPhases[phase].done )
+        {
+        vexBootPhases[phase].cycles = halGetCounterValue();
+        vexBootPhases[phase].time   = chTimeNow();
+        vexBootPhases[phase].done   = TRUE;
+
+        if( chEvtIsListeningI(&boot_event) )
+            {
+            chEvtBroadcastI(&boot_event);
+            chSchRescheduleS();
+            }
+        }
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Check if a boot phase has completed                            */
+/** @param[in]  phase the phase                                                */
+/** @returns    TRUE if complete                                               */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexBootIsDone( tVexBootPhase phase )
+{
+    if( phase >= kVexBootPhaseNum )
+        return(FALSE);
+
+    return( vexBootPhases[phase].done );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Wait for a boot phase to complete                              */
+/** @param[in]  phase the phase                                                */
+/** @param[in]  timeout longest time to wait in ticks, or TIME_INFINITE        */
+/** @returns    TRUE if the phase completed                                    */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexBootWait( tVexBootPhase phase, systime_t timeout )
+{
+    EventListener   el;
+    systime_t       start = chTimeNow();
+    systime_t       elapsed;
+
+    if( phase >= kVexBootPhaseNum )
+        return(FALSE);
+
+    // register before checking so a mark between the check and the
+    // wait is not lost
+    chEvtRegisterMask( &boot_event, &el, VEX_BOOT_EVENT );
+
+    while( !vexBootPhases[phase].done )
+        {
+        if( timeout == TIME_INFINITE )
+            chEvtWaitOne( VEX_BOOT_EVENT );
+        else
+            {
+            elapsed = chTimeNow() - start;
+            if( elapsed >= timeout )
+                break;
+            chEvtWaitOneTimeout( VEX_BOOT_EVENT, timeout - elapsed );
+            }
+        }
+
+    chEvtUnregister( &boot_event, &el );
+    // don't leave a pending flag for anything else using events
+    chEvtGetAndClearEvents( VEX_BOOT_EVENT );
+
+    return( vexBootPhases[phase].done );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the time a boot phase completed                            */
+/** @param[in]  phase the phase                                                */
+/** @returns    system time in ticks, 0 if not complete                        */
+/*-----------------------------------------------------------------------------*/
+
+systime_t
+vexBootTimeGet( tVexBootPhase phase )
+{
+    if( phase >= kVexBootPhaseNum || !vexBootPhases[phase].done )
+        return(0);
+
+    return( vexBootPhases[phase].time );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show boot phase timing                                         */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The cycle counter wraps after about 60 seconds so microsecond times are
+ *  only shown for phases that completed before then.
+ */
+
+void
+vexBootDebug(vexStream *chp, int argc, char *argv[])
+{
+    int16_t     i;
+    uint32_t    us;
+    uint32_t    div = halGetCounterFrequency() / 1000000;
+
+    (void)argc;
+    (void)argv;
+
+    vex_chprintf(chp, "phase              ms         us\r\n");
+
+    for(i=0;i<kVexBootPhaseNum;i++)
+        {
+        vex_chprintf(chp, "%-14s ", vexBootNames[i] );
+
+        if( !vexBootPhases[i].done )
+            {
+            vex_chprintf(chp, "    pending\r\n");
+            continue;
+            }
+
+        vex_chprintf(chp, "%6d ", (vexBootPhases[i].time * 1000) / CH_FREQUENCY );
+
+        if( vexBootPhases[i].time < MS2ST(50000) )
+            {
+            us = vexBootPhases[i].cycles / div;
+            vex_chprintf(chp, "%10d\r\n", us );
+            }
+        else
+            vex_chprintf(chp, "         -\r\n");
+        }
+
+    vex_chprintf(chp, "imes found %d\r\n", vexImeGetChannelMax() );
+}
@@ -0,0 +1,110 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexboot.h                                                    */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __VEXBOOT__
+#define __VEXBOOT__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexboot.h
+  * @brief   Boot sequencing and timing, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Time after reset that the master cpu has finished resetting us  */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  The master issues two additional resets after power on at 100mS intervals
+ */
+#define VEX_BOOT_MASTER_RESET_MS    120
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Longest wait for IME discovery before calling vexUserInit      */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  The wait ends as soon as any IME is found, it only runs to the limit on
+ *  a robot with none.  The limit is the old fixed startup delay so IMEs
+ *  that power up late are still found.
+ */
+#if !defined(VEX_BOOT_IME_TIMEOUT_MS)
+#define VEX_BOOT_IME_TIMEOUT_MS     2000
+#endif
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Boot phases, in the order they usually complete                */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kVexBootCortexInit = 0,     ///< vexCortexInit called
+    kVexBootSpiInit,            ///< spi driver started
+    kVexBootAdcInit,            ///< adc conversions running
+    kVexBootLcdInit,            ///< lcd threads started
+    kVexBootImeInit,            ///< ime discovery started
+    kVexBootUserSetup,          ///< vexUserSetup returned
+    kVexBootTasksStarted,       ///< system and monitor tasks running
+    kVexBootMasterReset,        ///< master reset window has passed
+    kVexBootSpiOnline,          ///< first valid data from the master
+    kVexBootImeReady,           ///< first ime discovery complete
+    kVexBootUserInit,           ///< vexUserInit called
+    kVexBootUserInitDone,       ///< vexUserInit returned
+    kVexBootGyroReady,          ///< gyro calibration complete (optional)
+    kVexBootFirstEnable,        ///< first autonomous or driver task started
+
+    kVexBootPhaseNum
+    } tVexBootPhase;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        vexBootMark( tVexBootPhase phase );
+bool_t      vexBootIsDone( tVexBootPhase phase );
+bool_t      vexBootWait( tVexBootPhase phase, systime_t timeout );
+systime_t   vexBootTimeGet( tVexBootPhase phase );
+void        vexBootDebug(vexStream *chp, int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __VEXBOOT__
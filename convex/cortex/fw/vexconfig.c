@@ -268,6 +268,14 @@ vexMotorConfigure( vexMotorCfg *cfg, int16_t cfg_num )
         // set reversal if necessary
         vexMotorDirectionSet( _cfg->port, _cfg->reversed );
 
+        // output linearization and battery compensation
+        if( _cfg->options & kVexMotorOptNoLinearize )
+            vexMotorLinearizeSet( _cfg->port, FALSE );
+        else
+        if( _cfg->options & kVexMotorOptLinearize )
+            vexMotorLinearizeSet( _cfg->port, TRUE );
+        vexMotorBatteryCompSet( _cfg->port, (_cfg->options & kVexMotorOptBatteryComp) ? TRUE : FALSE );
+
         switch( _cfg->stype )
             {
             case    kVexSensorIME:
@@ -114,6 +114,7 @@ typedef struct _vexMotorCfg {
     bool_t              reversed;   ///< Motor is reversed if true
     tVexSensorType      stype;      ///< Sensor type used for motor position
     int16_t             channel;    ///< The above sensor channel
+    uint16_t            options;    ///< kVexMotorOpt flags, may be omitted
 } vexMotorCfg;
 
 /*-----------------------------------------------------------------------------*/
@@ -44,6 +44,9 @@
 /*-----------------------------------------------------------------------------*/
 
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "ch.h"         // needs for all ChibiOS programs
 #include "hal.h"        // hardware abstraction layer header
 #include "vex.h"        // vex library header
@@ -94,7 +97,14 @@ static EVENTSOURCE_DECL(task_terminate);
 /*-----------------------------------------------------------------------------*/
 /** @brief      Storage for the user threads                                   */
 /*-----------------------------------------------------------------------------*/
+/** @note
+ *  Each thread keeps the index of its slot in p_vexslot (THREAD_EXT_FIELDS in
+ *  chconf.h) so finding a registered thread does not need to search the array,
+ *  the size only affects registration and the monitor task.
+ */
+#if !defined(MAX_THREAD)
 #define MAX_THREAD  20
+#endif
 static  vexThread   myThreads[MAX_THREAD];
 
 /*-----------------------------------------------------------------------------*/
@@ -107,6 +117,30 @@ void   CleanupTask( Thread *tp )  __attribute__ ((weak));
 /*-----------------------------------------------------------------------------*/
 static  bool_t      vexKillAll = FALSE;
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Callbacks run by the system task before each spi transfer      */
+/*-----------------------------------------------------------------------------*/
+#define MAX_TICK_CALLBACK   4
+static  vexTickCallback volatile tickCallbacks[MAX_TICK_CALLBACK];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the registry slot for a thread                             */
+/** @param[in]  tp pointer to the Thread structure                             */
+/** @return     the slot or -1 if not registered                               */
+/*-----------------------------------------------------------------------------*/
+
+static int16_t
+_vexTaskSlot( Thread *tp )
+{
+    int16_t     i = tp->p_vexslot;
+
+    // the slot may have been cleared by the monitor task
+    if( i >= 0 && i < MAX_THREAD && myThreads[ i ].tp == tp )
+        return( i );
+
+    return( -1 );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Register a thread so it can be terminated during vexSleep      */
 /** @param[in]  name string describing the thread                              */
@@ -127,21 +161,17 @@ vexTaskRegister(char *name)
 void
 vexTaskRegisterPersistant(char *name, bool_t p )
 {
-    uint16_t    i;
+    int16_t     i;
 
     // register name
     chRegSetThreadName(name);
 
-    // check the array to see if this thread was already registered
-    for(i=0;i<MAX_THREAD;i++)
+    // check to see if this thread was already registered
+    if( (i = _vexTaskSlot( chThdSelf() )) >= 0 )
         {
-        // if we are already in the array
-        if( myThreads[ i ].tp == chThdSelf())
-            {
-            // update persistent flag
-            myThreads[ i ].persistent = p;
-            return;
-            }
+        // update persistent flag
+        myThreads[ i ].persistent = p;
+        return;
         }
 
     // So we are not registered, look for an empty slot
@@ -151,6 +181,7 @@ vexTaskRegisterPersistant(char *name, bool_t p )
             {
             myThreads[ i ].tp = chThdSelf();
             myThreads[ i ].persistent = p;
+            chThdSelf()->p_vexslot = i;
             chEvtRegisterMask(&task_terminate, &myThreads[ i ].el, 1);
             break;
             }
@@ -166,19 +197,7 @@ vexTaskRegisterPersistant(char *name, bool_t p )
 bool_t
 vexTaskIsRegistered( Thread *tp )
 {
-    uint16_t    i;
-    bool_t  isreg = FALSE;
-
-    for(i=0;i<MAX_THREAD;i++)
-        {
-        // see if we are already in the array
-        if( myThreads[ i ].tp == tp)
-            {
-            isreg = TRUE;
-            break;
-            }
-        }
-    return(isreg);
+    return( _vexTaskSlot( tp ) >= 0 );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -190,19 +209,12 @@ vexTaskIsRegistered( Thread *tp )
 bool_t
 vexTaskPersistentGet( Thread *tp )
 {
-    uint16_t    i;
-    bool_t      p = FALSE;
+    int16_t     i;
 
-    for(i=0;i<MAX_THREAD;i++)
-        {
-        // see if we are already in the array
-        if( myThreads[ i ].tp == tp)
-            {
-            p = myThreads[ i ].persistent;
-            break;
-            }
-        }
-    return(p);
+    if( (i = _vexTaskSlot( tp )) < 0 )
+        return(FALSE);
+
+    return( myThreads[ i ].persistent );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -214,17 +226,10 @@ vexTaskPersistentGet( Thread *tp )
 void
 vexTaskPersistentSet( Thread *tp, bool_t p )
 {
-    uint16_t    i;
+    int16_t     i;
 
-    for(i=0;i<MAX_THREAD;i++)
-        {
-        // see if we are already in the array
-        if( myThreads[ i ].tp == tp)
-            {
-            myThreads[ i ].persistent = p;
-            break;
-            }
-        }
+    if( (i = _vexTaskSlot( tp )) >= 0 )
+        myThreads[ i ].persistent = p;
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -288,35 +293,35 @@ vexTaskEmergencyStop()
 void
 vexSleep( int32_t msec )
 {
+    // overran a mode change, drop to the lowest priority
+    if( chThdSelf()->p_vexdemote && chThdGetPriority() > LOWPRIO )
+        chThdSetPriority( LOWPRIO );
+
     if( (chEvtWaitAnyTimeout( ALL_EVENTS, MS2ST(msec) ) != 0) || chThdShouldTerminate() )
         {
         // We used to lock here, that was incorrect and has been removed
         // we have been asked to terminate either by the THD_TERMINATE flag being set or
         // by an event sent from the task_terminate event source
-        uint16_t i;
-        for(i=0;i<MAX_THREAD;i++)
+        int16_t i;
+        if( (i = _vexTaskSlot( chThdSelf() )) >= 0 )
             {
-            if( myThreads[ i ].tp == chThdSelf() )
+            // A persistent thread ?
+            if( myThreads[ i ].persistent == TRUE )
                 {
-                // A persistent thread ?
-                if( myThreads[ i ].persistent == TRUE )
-                    {
-                    // do not terminate unless a real terminate request
-                    if(!chThdShouldTerminate())
-                        return;
-                    }
-                // unregister the event listener
-                chEvtUnregister( &task_terminate, &myThreads[ i ].el );
-
-                // may have been started by the ROBOTC glue code
-                if( CleanupTask )
-                    CleanupTask( myThreads[ i ].tp );
-
-                // If terminated rather than event then clear slot
-                if(chThdShouldTerminate())
-                    myThreads[ i ].tp = (Thread *)0;
-                break;
+                // do not terminate unless a real terminate request
+                if(!chThdShouldTerminate())
+                    return;
                 }
+            // unregister the event listener
+            chEvtUnregister( &task_terminate, &myThreads[ i ].el );
+
+            // may have been started by the ROBOTC glue code
+            if( CleanupTask )
+                CleanupTask( myThreads[ i ].tp );
+
+            // If terminated rather than event then clear slot
+            if(chThdShouldTerminate())
+                myThreads[ i ].tp = (Thread *)0;
             }
 
         // terminate ourself
@@ -324,15 +329,476 @@ vexSleep( int32_t msec )
         }
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Drop the running thread to LOWPRIO if it overran a mode change */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Called from SYSTEM_TICK_EVENT_HOOK (chconf.h) inside the kernel lock, for
+ *  threads that never call vexSleep.  Only the running thread is changed, it
+ *  is not in the ready list so, as in chThdSetPriority, just the priority
+ *  fields are written.  The kernel checks for preemption on the way out of
+ *  the tick interrupt so any ready user thread runs straight away.
+ */
+void
+vexTaskSystemTick(void)
+{
+    Thread  *tp = chThdSelf();
+
+    if( !tp->p_vexdemote || tp->p_prio <= LOWPRIO )
+        return;
+
+#if CH_USE_MUTEXES
+    // a priority raised by a mutex is lowered when the mutex is released
+    if( tp->p_prio == tp->p_realprio )
+        tp->p_prio = LOWPRIO;
+    tp->p_realprio = LOWPRIO;
+#else
+    tp->p_prio = LOWPRIO;
+#endif
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Add a function to be called every system tick                  */
+/** @param[in]  cb the function to call                                        */
+/** @returns    TRUE if the callback was added                                 */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The callback runs on the system task, at high priority, immediately before
+ *  motor values are sent to the master processor.  It must not block and
+ *  should complete in well under 1mS.
+ */
+bool_t
+vexSystemTickCallbackAdd( vexTickCallback cb )
+{
+    uint16_t    i;
+    bool_t      added = FALSE;
+
+    if( cb == NULL )
+        return(FALSE);
+
+    chSysLock();
+    for(i=0;i<MAX_TICK_CALLBACK;i++)
+        {
+        if( tickCallbacks[i] == cb )
+            {
+            added = TRUE;
+            break;
+            }
+        }
+    for(i=0;i<MAX_TICK_CALLBACK && !added;i++)
+        {
+        if( tickCallbacks[i] == NULL )
+            {
+            tickCallbacks[i] = cb;
+            added = TRUE;
+            }
+        }
+    chSysUnlock();
+
+    return(added);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Remove a system tick callback                                  */
+/** @param[in]  cb the function to remove                                      */
+/** @returns    TRUE if the callback was found                                 */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexSystemTickCallbackRemove( vexTickCallback cb )
+{
+    uint16_t    i;
+    bool_t      found = FALSE;
+
+    chSysLock();
+    for(i=0;i<MAX_TICK_CALLBACK;i++)
+        {
+        if( tickCallbacks[i] == cb )
+            {
+            tickCallbacks[i] = NULL;
+            found = TRUE;
+            }
+        }
+    chSysUnlock();
+
+    return(found);
+}
+
 /*-----------------------------------------------------------------------------*/
 /*  Stack and working area for the user threads, autonomous or drover control  */
-/*  only one if these can be active so re-use space                            */
+/*  each mode has its own so the next one can be waiting before the last ends  */
+/*-----------------------------------------------------------------------------*/
+
+static  WORKING_AREA(waVexAutonTask, USER_TASK_STACK_SIZE);
+static  WORKING_AREA(waVexOperatorTask, USER_TASK_STACK_SIZE);
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Competition modes used by the monitor task                     */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kVexModeDisabled = 0,
+    kVexModeAutonomous,
+    kVexModeOperator,
+
+    kVexModeNum
+} tVexMode;
+
+static  const char  *vexModeNames[kVexModeNum] = { "disabled", "auton", "operator" };
+
 /*-----------------------------------------------------------------------------*/
+/** @brief      Pre-created (suspended) or running mode threads                */
+/*-----------------------------------------------------------------------------*/
+static  Thread      *modeThreads[kVexModeNum];
+static  bool_t       modeStarted[kVexModeNum];
 
-static  WORKING_AREA(waVexUserTask, USER_TASK_STACK_SIZE);
+/*-----------------------------------------------------------------------------*/
+/** @brief      Log of the most recent mode transitions                        */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t     from;
+    uint8_t     to;
+    uint8_t     overrun;        ///< threads still running when budget expired
+    uint8_t     deferred;       ///< next mode thread still running from before
+    systime_t   time;           ///< system time the change was seen
+    uint32_t    stop_us;        ///< time to stop the previous mode
+    uint32_t    start_us;       ///< time from detection to next mode resumed
+} vexTransition;
+
+#define MAX_TRANSITION  8
+static  vexTransition   transitions[MAX_TRANSITION];
+static  uint16_t        transitionCount = 0;
+static  uint32_t        transitionOverruns = 0;
+static  uint32_t        transitionBudget = VEX_TRANSITION_BUDGET_MS;
+
+#define _ModeCyclesToUs( x )    ((x) / (halGetCounterFrequency() / 1000000))
 
 /*-----------------------------------------------------------------------------*/
-/*  Task that runs every 15mS and monitors competition state                   */
+/** @brief      Set the time allowed for user threads to stop                  */
+/** @param[in]  ms the budget in mS                                            */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Threads that have not stopped when the budget expires are left to finish
+ *  and are reaped later by the monitor task, the next mode is started anyway.
+ *  They are dropped to the lowest priority so they cannot preempt the new
+ *  mode.  Motors are always stopped as soon as the mode change is seen.
+ */
+void
+vexTransitionBudgetSet( uint32_t ms )
+{
+    if( ms < 1 )
+        ms = 1;
+
+    transitionBudget = ms;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Create a mode thread in the suspended state                    */
+/** @param[in]  mode the mode to create the thread for                         */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  chThdCreateI does not fill the working area, do that here so the stack
+ *  high water mark is still valid.
+ */
+static void
+_vexModeThreadCreate( tVexMode mode )
+{
+    uint8_t    *wsp;
+    size_t      size;
+    tfunc_t     pf;
+
+    if( mode == kVexModeDisabled || modeThreads[ mode ] != NULL )
+        return;
+
+    if( mode == kVexModeAutonomous )
+        {
+        wsp  = (uint8_t *)waVexAutonTask;
+        size = sizeof(waVexAutonTask);
+        pf   = vexAutonomous;
+        }
+    else
+        {
+        wsp  = (uint8_t *)waVexOperatorTask;
+        size = sizeof(waVexOperatorTask);
+        pf   = vexOperator;
+        }
+
+#if CH_DBG_FILL_THREADS
+    memset( wsp, CH_THREAD_FILL_VALUE, sizeof(Thread) );
+    memset( wsp + sizeof(Thread), CH_STACK_FILL_VALUE, size - sizeof(Thread) );
+#endif
+
+    chSysLock();
+    modeThreads[ mode ] = chThdCreateI( wsp, size, USER_THREAD_PRIORITY, pf, NULL );
+    modeStarted[ mode ] = FALSE;
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Reap user threads that have finished                           */
+/** @param[in]  budget the mS allowed for threads to finish, 0 to just check   */
+/** @return     number of threads that are still running                       */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Polls rather than blocking in chThdWait so a thread that ignores the
+ *  terminate request cannot hold up the next mode.  Suspended mode threads
+ *  that have not yet been started are left alone.
+ */
+static uint16_t
+_vexModeThreadsReap( uint32_t budget )
+{
+    systime_t   start = chTimeNow();
+    uint16_t    running;
+    uint16_t    i;
+    Thread     *tp;
+
+    do  {
+        running = 0;
+
+        for(i=kVexModeAutonomous;i<kVexModeNum;i++)
+            {
+            if( (tp = modeThreads[ i ]) == NULL || !modeStarted[ i ] )
+                continue;
+
+            if( chThdTerminated( tp ) )
+                {
+                chThdWait( tp );
+                modeThreads[ i ] = NULL;
+                }
+            else
+                running++;
+            }
+
+        for(i=0;i<MAX_THREAD;i++)
+            {
+            if( ( (tp = myThreads[ i ].tp) == NULL) || (myThreads[ i ].persistent == TRUE) )
+                continue;
+
+            if( chThdTerminated( tp ) )
+                {
+                chThdWait( tp );
+                myThreads[ i ].tp = (Thread *)0;
+                }
+            else
+                running++;
+            }
+
+        if( running == 0 || (systime_t)(chTimeNow() - start) >= MS2ST(budget) )
+            break;
+
+        chThdSleepMilliseconds(1);
+        } while( TRUE );
+
+    return( running );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start the thread for a mode                                    */
+/** @param[in]  mode the mode to start                                         */
+/** @param[in]  budget the mS allowed for an old instance to finish            */
+/** @return     TRUE if the thread was started                                 */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The thread is normally created while disabled.  If it overran the last
+ *  time this mode ended it may still be running, that instance owns the
+ *  working area so it is given the budget to finish.  Polls rather than
+ *  waiting in chThdWait, if it has not finished the start is deferred and
+ *  the monitor task tries again on the next poll.
+ */
+static bool_t
+_vexModeThreadStart( tVexMode mode, uint32_t budget )
+{
+    systime_t   start = chTimeNow();
+    Thread     *tp;
+
+    while( (tp = modeThreads[ mode ]) != NULL && modeStarted[ mode ] )
+        {
+        if( chThdTerminated( tp ) )
+            {
+            chThdWait( tp );
+            modeThreads[ mode ] = NULL;
+            }
+        else
+        if( (systime_t)(chTimeNow() - start) >= MS2ST(budget) )
+            return( FALSE );
+        else
+            chThdSleepMilliseconds(1);
+        }
+
+    _vexModeThreadCreate( mode );
+    modeStarted[ mode ] = TRUE;
+    chThdResume( modeThreads[ mode ] );
+
+    return( TRUE );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Drop user threads that overran to the lowest priority          */
+/** @param[in]  from the mode that is ending                                   */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A thread that ignores the terminate request would otherwise keep running
+ *  at user priority into the next mode.  At LOWPRIO it only runs when every
+ *  other thread is waiting, the mode thread of the new mode is not touched.
+ *
+ *  Only a flag is set here, the thread lowers its own priority in vexSleep
+ *  or at the next system tick it is running for, see vexTaskSystemTick.
+ */
+static void
+_vexModeThreadDemoteI( Thread *tp )
+{
+    if( tp == NULL || tp->p_state == THD_STATE_FINAL )
+        return;
+
+    tp->p_vexdemote = TRUE;
+}
+
+static void
+_vexModeThreadsDemote( tVexMode from )
+{
+    uint16_t    i;
+
+    chSysLock();
+    _vexModeThreadDemoteI( modeThreads[ from ] );
+
+    for(i=0;i<MAX_THREAD;i++)
+        {
+        if( myThreads[ i ].persistent == TRUE )
+            continue;
+        _vexModeThreadDemoteI( myThreads[ i ].tp );
+        }
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Change from one competition mode to the next                   */
+/** @param[in]  from the mode that is ending                                   */
+/** @param[in]  to the mode that is starting                                   */
+/** @return     TRUE if the thread for the new mode is still to be started     */
+/*-----------------------------------------------------------------------------*/
+
+static bool_t
+_vexModeTransition( tVexMode from, tVexMode to )
+{
+    vexTransition  *t = &transitions[ transitionCount++ % MAX_TRANSITION ];
+    uint32_t        start = halGetCounterValue();
+    Thread         *tp;
+
+    t->from = from;
+    t->to   = to;
+    t->time = chTimeNow();
+
+    if( from != kVexModeDisabled )
+        {
+        // motors stop first, whatever the user code is doing
+        vexMotorStopAll();
+
+        // ask the mode thread and everything it started to finish
+        if( (tp = modeThreads[ from ]) != NULL )
+            chThdTerminate( tp );
+
+        chSysLock();
+        if( chEvtIsListeningI(&task_terminate) )
+            chEvtBroadcastI(&task_terminate);
+        chSysUnlock();
+
+        t->overrun = _vexModeThreadsReap( transitionBudget );
+        if( t->overrun )
+            {
+            transitionOverruns++;
+            _vexModeThreadsDemote( from );
+            }
+
+        // again in case a thread set a motor on the way out
+        vexMotorStopAll();
+        }
+    else
+        t->overrun = 0;
+
+    t->stop_us = _ModeCyclesToUs( halGetCounterValue() - start );
+
+    if( to != kVexModeDisabled && !_vexModeThreadStart( to, transitionBudget ) )
+        {
+        t->deferred = 1;
+        transitionOverruns++;
+        }
+    else
+        t->deferred = 0;
+
+    t->start_us = _ModeCyclesToUs( halGetCounterValue() - start );
+
+    return( t->deferred );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the current mode from the competition flags                */
+/*-----------------------------------------------------------------------------*/
+
+static tVexMode
+_vexModeGet(void)
+{
+    uint16_t    state = vexControllerCompetitonState();
+
+    if( (state & kFlagDisabled) == kFlagDisabled )
+        return( kVexModeDisabled );
+    if( (state & kFlagAutonomousMode) == kFlagAutonomousMode )
+        return( kVexModeAutonomous );
+
+    return( kVexModeOperator );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show recent competition mode transitions                       */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  mode              - show the current mode and recent transitions
+ *  mode budget <ms>  - set the time allowed for user threads to stop
+ *
+ *  An overrun means a user thread ignored the terminate request and was
+ *  still running when the budget expired.  It is dropped to the lowest
+ *  priority and reaped when it finishes.  While disabled its motors are
+ *  stopped on every poll, in autonomous or operator it can still set
+ *  motors when no other thread is ready, so fix the thread.
+ *
+ *  Deferred means the thread for the new mode was itself still running
+ *  from an earlier overrun, the new mode starts once that has finished.
+ */
+
+void
+vexTransitionDebug(vexStream *chp, int argc, char *argv[])
+{
+    uint16_t    i, n;
+    vexTransition  *t;
+
+    if( argc == 2 && !strcmp( argv[0], "budget" ) )
+        vexTransitionBudgetSet( atoi( argv[1] ) );
+
+    vex_chprintf( chp, "mode %s budget %dmS overruns %d\r\n",
+                  vexModeNames[ _vexModeGet() ], transitionBudget, transitionOverruns );
+
+    n = (transitionCount < MAX_TRANSITION) ? transitionCount : MAX_TRANSITION;
+    for(i=0;i<n;i++)
+        {
+        t = &transitions[ (transitionCount - n + i) % MAX_TRANSITION ];
+        vex_chprintf( chp, "%8d %-8s -> %-8s stop %6duS start %6duS",
+                      (t->time * 1000) / CH_FREQUENCY,
+                      vexModeNames[ t->from ], vexModeNames[ t->to ],
+                      t->stop_us, t->start_us );
+        if( t->overrun )
+            vex_chprintf( chp, " overrun %d", t->overrun );
+        if( t->deferred )
+            vex_chprintf( chp, " deferred" );
+        vex_chprintf( chp, "\r\n" );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Task that monitors competition state                                       */
+/*-----------------------------------------------------------------------------*/
+/*  Polled every VEX_MONITOR_POLL_MS so a mode change is seen no more than one */
+/*  poll after the spi frame that carried it.                                  */
 /*-----------------------------------------------------------------------------*/
 
 static WORKING_AREA(waVexCortexMonitorTask, MONITOR_TASK_STACK_SIZE);
@@ -340,8 +806,9 @@ static msg_t
 vexCortexMonitorTask(void *arg)
 {
     uint16_t    i;
-    Thread  *tp = NULL;
-    uint16_t    state;
+    tVexMode    mode = kVexModeDisabled;
+    tVexMode    next;
+    bool_t      pending = FALSE;
 
     (void)arg;
 
@@ -355,86 +822,67 @@ vexCortexMonitorTask(void *arg)
         myThreads[ i ].persistent = FALSE;
         }
 
-    // wait until all the master cpu resets are done
-    // it issues two additional resets after power on
-    // at 100mS intervals
-    chThdSleepMilliseconds(120);
-
 #ifndef  BOARD_OLIMEX_STM32_P103
-    // wait for good spi comms
-    while( vexSpiGetOnlineStatus() == 0 )
-        {
-        // wait for a while
-        chThdSleepMilliseconds(100);
-        }
+    // wait for good spi comms, the system task marks this as soon as
+    // the master sends valid data
+    vexBootWait( kVexBootSpiOnline, TIME_INFINITE );
 #endif
 
-    // another delay
-    chThdSleepMilliseconds(2000);
+    // wait for IME discovery so user init can see them, ends as soon as
+    // any are found, usually well before the master is online
+    vexBootWait( kVexBootImeReady, MS2ST(VEX_BOOT_IME_TIMEOUT_MS) );
 
     // pre auton function - may not exist
+    vexBootMark( kVexBootUserInit );
     if( vexUserInit )
         vexUserInit();
+    vexBootMark( kVexBootUserInitDone );
 
     while (TRUE)
         {
-        chThdSleepMilliseconds(16);
+        chThdSleepMilliseconds(VEX_MONITOR_POLL_MS);
+
+        next = _vexModeGet();
+
+        // Emergency stop, end the current mode and stay here
+        if( vexKillAll )
+            {
+            if( mode != kVexModeDisabled )
+                _vexModeTransition( mode, kVexModeDisabled );
+            mode = kVexModeDisabled;
+            pending = FALSE;
+            _vexModeThreadsReap( 0 );
+            continue;
+            }
 
-        // If enabled
-        if( (vexControllerCompetitonState() & kFlagDisabled ) != kFlagDisabled )
+        if( next != mode )
             {
-            if( (vexControllerCompetitonState() & kFlagAutonomousMode ) != kFlagAutonomousMode )
+            pending = _vexModeTransition( mode, next );
+            if( next != kVexModeDisabled )
+                vexBootMark( kVexBootFirstEnable );
+            mode = next;
+            }
+        else
+        if( pending )
+            {
+            // the old instance of this mode's thread had not finished
+            pending = !_vexModeThreadStart( mode, 0 );
+            }
+        else
+        if( mode == kVexModeDisabled )
+            {
+            // clean up anything that overran and get both modes ready
+            if( _vexModeThreadsReap( 0 ) == 0 )
                 {
-                // Operator control
-                // Start the operator thread at higher than normal priority
-                tp = chThdCreateStatic(waVexUserTask, sizeof(waVexUserTask), USER_THREAD_PRIORITY, vexOperator, NULL);
-                state = 0;
+                _vexModeThreadCreate( kVexModeAutonomous );
+                _vexModeThreadCreate( kVexModeOperator );
                 }
             else
                 {
-                // Autonomous
-                // Start the operator thread at higher than normal priority
-                tp = chThdCreateStatic(waVexUserTask, sizeof(waVexUserTask), USER_THREAD_PRIORITY, vexAutonomous, NULL);
-                state = kFlagAutonomousMode;
-                }
-
-            // While we are enabled, either auton or operator, wait here unless kill all flag is set
-            while( (vexControllerCompetitonState() & (kFlagDisabled | kFlagAutonomousMode)) == state )
-               {
-               chThdSleepMilliseconds(16);
-
-               // Emergency stop
-               if( vexKillAll )
-                   break;
-               }
-
-            // Broadcast termination event
-            chThdSleepMilliseconds(50);
-            chSysLock();
-            if( chEvtIsListeningI(&task_terminate) )
-                chEvtBroadcastI(&task_terminate);
-            chSysUnlock();
-            chThdSleepMilliseconds(50);
-
-            // wait for termination
-            chThdWait( tp );
-
-            // stop all motors
-            vexMotorStopAll();
-
-            // wait for all threads to stop
-            for(i=0;i<MAX_THREAD;i++)
-                {
-                if( ( myThreads[ i ].tp != 0 ) && (myThreads[ i ].persistent == FALSE) )
-                    {
-                    chThdWait( myThreads[ i ].tp );
-                    myThreads[ i ].tp = (Thread *)0;
-                    }
+                // nothing should drive while disabled, undo anything
+                // an overrun thread has set
+                vexMotorStopAll();
                 }
-
-            // We are done
-            while( vexKillAll )
-                chThdSleepMilliseconds(50);
             }
         }
 
@@ -448,29 +896,70 @@ vexCortexMonitorTask(void *arg)
 /*-----------------------------------------------------------------------------*/
 
 static WORKING_AREA(waVexCortexSystemTask, SYSTEM_TASK_STACK_SIZE);
+static vexPerfPeriodic  systemPerf;
+static vexPerfPeriodic  spiPerf;
 static msg_t
 vexCortexSystemTask(void *arg) {
       (void)arg;
       int16_t   m;
+      systime_t time;
+      vexTickCallback cb;
 
       chRegSetThreadName("system");
+      vexPerfPeriodicInit( &systemPerf, "system", SYSTEM_TASK_PERIOD_MS * 1000, 0 );
+      vexPerfPeriodicInit( &spiPerf, "spi", SYSTEM_TASK_PERIOD_MS * 1000, 0 );
 
       // wait until all the master cpu resets are done
       // it issues two additional resets after power on
-      // at 100mS intervals
-      chThdSleepMilliseconds(120);
+      // at 100mS intervals, time spent in init counts towards this
+      if( chTimeNow() < MS2ST(VEX_BOOT_MASTER_RESET_MS) )
+          chThdSleepUntil( MS2ST(VEX_BOOT_MASTER_RESET_MS) );
+      vexBootMark( kVexBootMasterReset );
+
+      time = chTimeNow();
 
       while (TRUE)
           {
-          chThdSleepMilliseconds(16);
+          // absolute wakeup time so anything run from the tick callbacks
+          // is phase locked to the spi transfers
+          time += MS2ST(SYSTEM_TASK_PERIOD_MS);
+          if( (systime_t)(time - chTimeNow()) <= (systime_t)MS2ST(SYSTEM_TASK_PERIOD_MS) )
+              chThdSleepUntil(time);
+          else
+              time = chTimeNow();    // overran, resync rather than catch up
+
+          vexPerfPeriodicStart( &systemPerf );
+
+          // run anything that needs to update motors before the transfer
+          for(m=0;m<MAX_TICK_CALLBACK;m++)
+              {
+              // read the slot once, it may be removed at any time
+              if( (cb = tickCallbacks[m]) != NULL )
+                  cb();
+              }
+
+          // apply fresh commands from the motor mailbox, stale ones decay
+          vexMotorCommandUpdate();
+
+          // rescale battery compensated motors
+          vexMotorBatteryUpdate();
 
           // get motor data
           // motor data 1 through 8 goes to spi slots 0 to 7
           for(m=0;m<8;m++)
-              vexSpiSetMotor( m, vexMotorGet( m+1 ), vexMotorDirectionGet(m+1) );
+              vexSpiSetMotor( m, vexMotorOutputGet( m+1 ), vexMotorDirectionGet(m+1) );
 
           // comms to master
+          vexPerfPeriodicStart( &spiPerf );
           vexSpiSend();
+          vexPerfPeriodicEnd( &spiPerf );
+          if( vexSpiGetOnlineStatus() )
+              vexBootMark( kVexBootSpiOnline );
+
+          // decode joysticks and send button events
+          vexControllerUpdate();
+
+          vexPerfPeriodicEnd( &systemPerf );
 #ifdef    VEX_WATCHDOG_ENABLE
           vexWatchdogReload();
 #endif
@@ -486,8 +975,12 @@ vexCortexSystemTask(void *arg) {
 void
 vexCortexInit()
 {
+    vexBootMark( kVexBootCortexInit );
+
     // Init SPI communications
     vexSpiInit();
+    vexControllerInit();
+    vexBootMark( kVexBootSpiInit );
 
     // Initialize the motors
     vexMotorInit();
@@ -496,6 +989,7 @@ vexCortexInit()
 #ifndef BOARD_OLIMEX_STM32_P103
     vexAdcInit();
 #endif
+    vexBootMark( kVexBootAdcInit );
 
     // start any test code
     vexTest();
@@ -515,6 +1009,7 @@ vexCortexInit()
     vexLcdPrintf( 1, 0, "ConVEX V%s" , CONVEX_VERSION);
     vexLcdPrintf( 1, 1, "VEX CORTEX LCD2" );
 #endif
+    vexBootMark( kVexBootLcdInit );
 
     // Init encoder data structures
     vexEncoderInit();
@@ -523,10 +1018,12 @@ vexCortexInit()
     i2cInit();
     // Init IMEs
     vexImeInit( &I2CD1, (vexStream *)SD_CONSOLE );
+    vexBootMark( kVexBootImeInit );
 
     // call user setup if it has been defined
     if( vexUserSetup )
         vexUserSetup();
+    vexBootMark( kVexBootUserSetup );
 
     // start interrupts
     vexExtIrqInit();
@@ -543,10 +1040,14 @@ vexCortexInit()
     vexWatchdogInit();
 #endif
 
+    // Start stack high water mark scanning
+    vexStackInit();
+
     // Start the system thread at higher than normal priority
     chThdCreateStatic(waVexCortexSystemTask, sizeof(waVexCortexSystemTask), SYSTEM_THREAD_PRIORITY, vexCortexSystemTask, NULL);
     // Start the monitor thread at higher than normal priority
     chThdCreateStatic(waVexCortexMonitorTask, sizeof(waVexCortexMonitorTask), MONITOR_THREAD_PRIORITY, vexCortexMonitorTask, NULL);
+    vexBootMark( kVexBootTasksStarted );
 }
 
 /*-----------------------------------------------------------------------------*/
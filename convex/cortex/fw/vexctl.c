@@ -47,6 +47,8 @@
 /*                                                                             */
 /*-----------------------------------------------------------------------------*/
 
+#include <string.h>
+
 #include "ch.h"         // needs for all ChibiOS programs
 #include "hal.h"        // hardware abstraction layer header
 #include "vex.h"        // vex library header
@@ -58,6 +60,39 @@
 
 static  uint16_t    vexLocalCompState;  ///< Used to override the comp state
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Decoded controller state, one for each transmitter             */
+/*-----------------------------------------------------------------------------*/
+static  vexCtlState ctlState[2];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Input shaping lookup tables indexed by the raw analog data     */
+/*-----------------------------------------------------------------------------*/
+static  int8_t      ctlShapeLut[2][4][256];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Press time and hold status used to generate hold events        */
+/*-----------------------------------------------------------------------------*/
+static  systime_t   ctlPressTime[2][VEX_CTL_BTN_NUM];
+static  uint16_t    ctlHeld[2];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Button event queue                                             */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The system task is the only writer, it stores an event and then advances
+ *  ctlEventSeq.  Readers keep their own sequence number so any number of tasks
+ *  can see every event without locking, a reader that falls more than the
+ *  queue size behind loses the oldest events.  The semaphore is only used to
+ *  wake readers, it is reset (releasing all waiting threads) after each frame
+ *  that generated events.
+ */
+#define CTL_EVENT_MASK  (VEX_CTL_EVENT_QUEUE_SIZE - 1)
+
+static  vexCtlEvent         ctlEvents[VEX_CTL_EVENT_QUEUE_SIZE];
+static  volatile uint32_t   ctlEventSeq = 0;
+static  SEMAPHORE_DECL(ctlEventSem, 0);
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Set competition state, a simulation of the competition modes   */
 /** @param[in]  ctl The control byte                                           */
@@ -115,112 +150,356 @@ vexControllerCompetitonState()
 }
 
 /*-----------------------------------------------------------------------------*/
-/** @brief      Get controller data                                            */
-/** @param[in]  index The required controller variable eg. Btn8U               */
-/** @returns    The requested controller data                                  */
+/** @brief      Convert raw joystick analog data                               */
+/** @param[in]  v the raw data                                                 */
+/** @returns    value in the range -127 to 127                                 */
+/*-----------------------------------------------------------------------------*/
+
+static int8_t
+_vexCtlAnalog( uint8_t v )
+{
+    // clip analog joystick at +127 (max would be +128)
+    return( ( v == 0xFF ) ? 127 : v - 127 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Build the lookup table for one analog channel                  */
+/** @param[out] lut the table to fill                                          */
+/** @param[in]  ch the channel, 0 to 3 for Ch1 to Ch4                          */
+/** @param[in]  shape the shaping parameters or NULL for none                  */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  The decoder may read the table while it is being built, for one frame a
+ *  channel can then return a value from either the old or new curve.
+ */
+static void
+_vexCtlShapeBuild( int8_t *lut, int16_t ch, const vexCtlShape *shape )
+{
+    int32_t     x, ax, y;
+    int32_t     db, expo, scale;
+    int16_t     raw;
+
+    db    = (shape == NULL) ? 0   : shape->deadband;
+    expo  = (shape == NULL) ? 0   : shape->expo;
+    scale = (shape == NULL) ? 100 : shape->scale;
+
+    if( db > 126 )
+        db = 126;
+    if( expo > 100 )
+        expo = 100;
+
+    for(raw=0;raw<256;raw++)
+        {
+        // same as vexControllerGet
+        x = _vexCtlAnalog( raw );
+        if( ch == 1 || ch == 2 )
+            x = -x;
+
+        ax = (x < 0) ? -x : x;
+
+        if( ax <= db )
+            y = 0;
+        else
+            {
+            // rescale so full range is still available
+            y = ((ax - db) * 127) / (127 - db);
+
+            // blend linear and cubic, y^3 fits easily in 32 bits
+            y = ((100 - expo) * y + expo * ((y * y * y) / (127 * 127))) / 100;
+
+            y = (y * scale) / 100;
+            if( y > 127 )
+                y = 127;
+
+            if( x < 0 )
+                y = -y;
+            }
+
+        if( shape != NULL && shape->invert )
+            y = -y;
+
+        lut[ raw ] = y;
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize the controller decoder                              */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Called from vexCortexInit before vexUserSetup, shaped channels start out
+ *  the same as the unshaped ones.
+ */
+void
+vexControllerInit()
+{
+    int16_t     i;
+
+    for(i=0;i<8;i++)
+        _vexCtlShapeBuild( ctlShapeLut[ i >> 2 ][ i & 3 ], i & 3, NULL );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set input shaping for an analog channel                        */
+/** @param[in]  index the channel, Ch1 to Ch4 or Ch1Xmtr2 to Ch4Xmtr2          */
+/** @param[in]  shape the shaping parameters or NULL to remove shaping         */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The shaping is compiled into a table that the decoder uses every spi
+ *  frame, reading a shaped channel with vexControllerShapedGet or from
+ *  vexCtlState.shaped costs no more than reading an unshaped one.
+ */
+void
+vexControllerShapeSet( tCtlIndex index, const vexCtlShape *shape )
+{
+    int16_t     ch = index & 0x7F;
+
+    if( ch > Ch4 )
+        return;
+
+    _vexCtlShapeBuild( ctlShapeLut[ (index < Ch1Xmtr2) ? 0 : 1 ][ ch ], ch, shape );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get an analog channel after input shaping                      */
+/** @param[in]  index the channel, Ch1 to Ch4 or Ch1Xmtr2 to Ch4Xmtr2          */
+/** @returns    the shaped value, -127 to 127                                  */
 /*-----------------------------------------------------------------------------*/
 
 int16_t
-vexControllerGet( tCtlIndex index )
+vexControllerShapedGet( tCtlIndex index )
 {
-    jsdata *js;
-    int16_t analog;
+    int16_t     ch = index & 0x7F;
 
-    // Get pointer to raw joystick data
-    if(index < Ch1Xmtr2)
-        js = vexSpiGetJoystickDataPtr( 1 );
-    else
-        js = vexSpiGetJoystickDataPtr( 2 );
+    if( ch > Ch4 )
+        return( 0 );
 
-    // decode data, needs transmitter 2 to be defined as index + 0x80
-    switch( index & 0x7F )
+    return( ctlState[ (index < Ch1Xmtr2) ? 0 : 1 ].shaped[ ch ] );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Add an event to the queue                                      */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_vexCtlEventPost( tVexCtlEventType type, uint8_t index, systime_t time )
+{
+    vexCtlEvent *ev = &ctlEvents[ ctlEventSeq & CTL_EVENT_MASK ];
+
+    ev->type  = type;
+    ev->index = index;
+    ev->time  = time;
+
+    // publish, single writer so no lock needed
+    ctlEventSeq++;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Decode one transmitter and generate button events              */
+/** @param[in]  xmtr 0 or 1 for the main or partner joystick                   */
+/** @param[in]  now the time of this frame                                     */
+/** @returns    TRUE if any events were generated                              */
+/*-----------------------------------------------------------------------------*/
+
+static bool_t
+_vexCtlDecode( int16_t xmtr, systime_t now )
+{
+    jsdata      *js = vexSpiGetJoystickDataPtr( xmtr + 1 );
+    vexCtlState *s  = &ctlState[ xmtr ];
+    uint16_t    buttons, changed, mask;
+    uint8_t     base = (xmtr == 0) ? 0 : Ch1Xmtr2;
+    bool_t      posted = FALSE;
+    int16_t     i;
+
+    s->axis[0] =  _vexCtlAnalog( js->Ch1 );
+    s->axis[1] = -_vexCtlAnalog( js->Ch2 );  // flip vertical axis
+    s->axis[2] = -_vexCtlAnalog( js->Ch3 );  // flip vertical axis
+    s->axis[3] =  _vexCtlAnalog( js->Ch4 );
+
+    s->shaped[0] = ctlShapeLut[ xmtr ][ 0 ][ (uint8_t)js->Ch1 ];
+    s->shaped[1] = ctlShapeLut[ xmtr ][ 1 ][ (uint8_t)js->Ch2 ];
+    s->shaped[2] = ctlShapeLut[ xmtr ][ 2 ][ (uint8_t)js->Ch3 ];
+    s->shaped[3] = ctlShapeLut[ xmtr ][ 3 ][ (uint8_t)js->Ch4 ];
+
+    // Accelerometers (there is no Z !)
+    s->accel[0] = js->acc_x - 127;
+    s->accel[1] = js->acc_y - 127;
+    s->accel[2] = js->acc_z - 127;
+
+    // btns[1] holds 8D to 7R and btns[0] 5D to 6U, this is the same
+    // order as tCtlIndex so bit n is button Btn8D + n
+    buttons = js->btns[1] | ((js->btns[0] & 0x0F) << 8);
+    changed = buttons ^ s->buttons;
+    s->buttons = buttons;
+
+    for(i=0,mask=1;i<VEX_CTL_BTN_NUM;i++,mask<<=1)
         {
-        // clip analog joystick at +127 (max would be +128)
-        case    Ch1:
-            analog = ( js->Ch1 == 0xFF ) ? 127 : js->Ch1 - 127;
-            return( analog );
-            break;
-        case    Ch2:
-            analog = ( js->Ch2 == 0xFF ) ? 127 : js->Ch2 - 127;
-            return( -analog ); // flip vertical axis
-            break;
-        case    Ch3:
-            analog = ( js->Ch3 == 0xFF ) ? 127 : js->Ch3 - 127;
-            return( -analog ); // flip vertical axis
-            break;
-        case    Ch4:
-            analog = ( js->Ch4 == 0xFF ) ? 127 : js->Ch4 - 127;
-            return( analog );
-            break;
+        if( changed & mask )
+            {
+            if( buttons & mask )
+                {
+                ctlPressTime[xmtr][i] = now;
+                _vexCtlEventPost( kVexCtlEventPress, base + Btn8D + i, now );
+                }
+            else
+                {
+                ctlHeld[xmtr] &= ~mask;
+                _vexCtlEventPost( kVexCtlEventRelease, base + Btn8D + i, now );
+                }
+            posted = TRUE;
+            }
+        else
+        if( (buttons & mask) && !(ctlHeld[xmtr] & mask) )
+            {
+            if( (systime_t)(now - ctlPressTime[xmtr][i]) >= MS2ST(VEX_CTL_HOLD_MS) )
+                {
+                ctlHeld[xmtr] |= mask;
+                _vexCtlEventPost( kVexCtlEventHold, base + Btn8D + i, now );
+                posted = TRUE;
+                }
+            }
+        }
 
-        case    Btn8D:
-            return( ( js->btns[1] & 0x01 ) ? 1 : 0 );
-            break;
-        case    Btn8L:
-            return( ( js->btns[1] & 0x02 ) ? 1 : 0 );
-            break;
-        case    Btn8U:
-            return( ( js->btns[1] & 0x04 ) ? 1 : 0 );
-            break;
-        case    Btn8R:
-            return( ( js->btns[1] & 0x08 ) ? 1 : 0 );
-            break;
+    return( posted );
+}
 
-        case    Btn7D:
-            return( ( js->btns[1] & 0x10 ) ? 1 : 0 );
-            break;
-        case    Btn7L:
-            return( ( js->btns[1] & 0x20 ) ? 1 : 0 );
-            break;
-        case    Btn7U:
-            return( ( js->btns[1] & 0x40 ) ? 1 : 0 );
-            break;
-        case    Btn7R:
-            return( ( js->btns[1] & 0x80 ) ? 1 : 0 );
-            break;
+/*-----------------------------------------------------------------------------*/
+/** @brief      Decode the controller data from the latest spi frame           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Called by the system task after each spi transfer, everything else reads
+ *  the decoded state so the raw data is only looked at once per frame.
+ */
+void
+vexControllerUpdate()
+{
+    systime_t   now = chTimeNow();
+    bool_t      posted;
 
-        case    Btn5D:
-            return( ( js->btns[0] & 0x01 ) ? 1 : 0 );
-            break;
-        case    Btn5U:
-            return( ( js->btns[0] & 0x02 ) ? 1 : 0 );
-            break;
+    posted  = _vexCtlDecode( 0, now );
+    posted |= _vexCtlDecode( 1, now );
 
-        case    Btn6D:
-            return( ( js->btns[0] & 0x04 ) ? 1 : 0 );
-            break;
-        case    Btn6U:
-            return( ( js->btns[0] & 0x08 ) ? 1 : 0 );
-            break;
+    // wake anything waiting for events
+    if( posted )
+        chSemReset( &ctlEventSem, 0 );
+}
 
-        // Accelerometers (there is no Z !)
-        case    AcclX:
-            return( js->acc_x - 127 );
-            break;
-        case    AcclY:
-            return( js->acc_y - 127 );
-            break;
-        case    AcclZ:
-            return( js->acc_z - 127 );
-            break;
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the decoded state for a transmitter                        */
+/** @param[in]  xmtr 1 or 2 for the main or partner joystick                   */
+/** @returns    pointer to the state, updated every spi frame                  */
+/*-----------------------------------------------------------------------------*/
+
+const vexCtlState *
+vexControllerStateGet( int16_t xmtr )
+{
+    return( ( xmtr == 2 ) ? &ctlState[1] : &ctlState[0] );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize an event reader                                     */
+/** @param[in]  r pointer to the reader                                        */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The reader starts with the next event, anything older is ignored.
+ */
+void
+vexControllerEventReaderInit( vexCtlEventReader *r )
+{
+    r->seq  = ctlEventSeq;
+    r->lost = 0;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the next button event                                      */
+/** @param[in]  r pointer to the reader                                        */
+/** @param[out] ev pointer to storage for the event                            */
+/** @param[in]  timeout time to wait, TIME_IMMEDIATE or TIME_INFINITE allowed  */
+/** @returns    TRUE if an event was returned, FALSE on timeout                */
+/*-----------------------------------------------------------------------------*/
 
+bool_t
+vexControllerEventGet( vexCtlEventReader *r, vexCtlEvent *ev, systime_t timeout )
+{
+    uint32_t    seq;
+    msg_t       msg;
+
+    while( TRUE )
+        {
+        seq = ctlEventSeq;
+
+        if( r->seq != seq )
+            {
+            // too far behind, skip to the oldest event that is safe to read
+            if( (seq - r->seq) >= VEX_CTL_EVENT_QUEUE_SIZE )
+                {
+                r->lost += seq - r->seq - (VEX_CTL_EVENT_QUEUE_SIZE - 1);
+                r->seq   = seq - (VEX_CTL_EVENT_QUEUE_SIZE - 1);
+                }
+
+            *ev = ctlEvents[ r->seq & CTL_EVENT_MASK ];
+
+            // the event may have been overwritten while we were copying
+            if( (ctlEventSeq - r->seq) >= VEX_CTL_EVENT_QUEUE_SIZE )
+                continue;
+
+            r->seq++;
+            return( TRUE );
+            }
+
+        // nothing new, wait for the next frame with events
+        chSysLock();
+        if( r->seq == ctlEventSeq )
+            msg = chSemWaitTimeoutS( &ctlEventSem, timeout );
+        else
+            msg = RDY_OK;
+        chSysUnlock();
+
+        if( msg == RDY_TIMEOUT )
+            return( FALSE );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get controller data                                            */
+/** @param[in]  index The required controller variable eg. Btn8U               */
+/** @returns    The requested controller data                                  */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+vexControllerGet( tCtlIndex index )
+{
+    vexCtlState *s;
+    int16_t     i = index & 0x7F;
+
+    // decoded data, needs transmitter 2 to be defined as index + 0x80
+    s = ( index < Ch1Xmtr2 ) ? &ctlState[0] : &ctlState[1];
+
+    if( i <= Ch4 )
+        return( s->axis[ i - Ch1 ] );
+    if( i <= Btn6U )
+        return( ( s->buttons & VEX_CTL_BTN_MASK(i) ) ? 1 : 0 );
+    if( i <= AcclZ )
+        return( s->accel[ i - AcclX ] );
+
+    switch( i )
+        {
         // Check for any button in the group
         case    Btn5:
-            return( ( js->btns[0] & 0x03 ) ? 1 : 0 );
+            return( ( s->buttons & 0x0300 ) ? 1 : 0 );
             break;
         case    Btn6:
-            return( ( js->btns[0] & 0x0C ) ? 1 : 0 );
+            return( ( s->buttons & 0x0C00 ) ? 1 : 0 );
             break;
         case    Btn7:
-            return( ( js->btns[1] & 0xF0 ) ? 1 : 0 );
+            return( ( s->buttons & 0x00F0 ) ? 1 : 0 );
             break;
         case    Btn8:
-            return( ( js->btns[1] & 0x0F ) ? 1 : 0 );
+            return( ( s->buttons & 0x000F ) ? 1 : 0 );
             break;
 
         // Any button on the controller
         case    BtnAny:
-            return( ( js->btns[0] || js->btns[1] ) ? 1 : 0 );
+            return( ( s->buttons != 0 ) ? 1 : 0 );
             break;
 
         default:
@@ -235,20 +514,72 @@ vexControllerGet( tCtlIndex index )
 void
 vexControllerReleaseWait( tCtlIndex index )
 {
-    int timeout;
+    vexCtlEventReader   r;
+    vexCtlEvent         ev;
+    systime_t           start = chTimeNow();
 
     // Does not make sense on analog channels
     // relies on Btn8D being enumerated to 5
     if( ( index & 0x7F ) < Btn8D )
         return;
 
+    vexControllerEventReaderInit( &r );
+
     // Max of 5 seconds
-    for(timeout=0;timeout<(5000/25);timeout++)
+    while( (systime_t)(chTimeNow() - start) < MS2ST(5000) )
         {
         if( vexControllerGet(index) == 0 )
             return;
 
-        vexSleep(25);
+        // wakes on any button event, the 25mS limit is so a terminate
+        // request is still seen by vexSleep
+        vexControllerEventGet( &r, &ev, MS2ST(25) );
+        vexSleep(0);
         }
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show decoded controller state and button events                */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  "ctl" shows the state of both transmitters, "ctl events" shows button
+ *  events for 10 seconds.
+ */
+void
+vexControllerDebug(vexStream *chp, int argc, char *argv[])
+{
+    static const char   *types[] = { "press", "release", "hold" };
+    vexCtlEventReader   r;
+    vexCtlEvent         ev;
+    systime_t           start;
+    int16_t             i;
+
+    if( argc > 0 && strcmp( argv[0], "events" ) == 0 )
+        {
+        vexControllerEventReaderInit( &r );
+        start = chTimeNow();
+
+        while( (systime_t)(chTimeNow() - start) < MS2ST(10000) )
+            {
+            if( vexControllerEventGet( &r, &ev, MS2ST(100) ) )
+                vex_chprintf( chp, "%8d xmtr%d %3d %s\r\n", (ev.time * 1000) / CH_FREQUENCY,
+                              (ev.index & 0x80) ? 2 : 1, ev.index & 0x7F, types[ ev.type ] );
+            }
+        if( r.lost )
+            vex_chprintf( chp, "lost %d\r\n", r.lost );
+        return;
+        }
+
+    for(i=0;i<2;i++)
+        {
+        vex_chprintf( chp, "xmtr%d ch %4d %4d %4d %4d shaped %4d %4d %4d %4d acc %4d %4d %4d btn %04X\r\n", i+1,
+                      ctlState[i].axis[0], ctlState[i].axis[1], ctlState[i].axis[2], ctlState[i].axis[3],
+                      ctlState[i].shaped[0], ctlState[i].shaped[1], ctlState[i].shaped[2], ctlState[i].shaped[3],
+                      ctlState[i].accel[0], ctlState[i].accel[1], ctlState[i].accel[2],
+                      ctlState[i].buttons );
+        }
+    vex_chprintf( chp, "events %d\r\n", ctlEventSeq );
+}
@@ -95,6 +95,75 @@ typedef enum {
     kFlagDisabled            = 0x80,     // 0 == Enabled             1 == Disabled.
 } tVexControlState;
 
+/*-----------------------------------------------------------------------------*/
+/** @brief  Controller state decoded once per spi frame                        */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Analog values are already normalized in the same way vexControllerGet
+ *  returns them, buttons are packed with bit (index - Btn8D) set when that
+ *  button is pressed.
+ */
+typedef struct {
+    int8_t      axis[4];        ///< Ch1 to Ch4, vertical axes flipped
+    int8_t      shaped[4];      ///< Ch1 to Ch4 after input shaping
+    int16_t     accel[3];       ///< AcclX, AcclY and AcclZ
+    uint16_t    buttons;        ///< one bit for each button
+} vexCtlState;
+
+/** @brief  Mask for a button in vexCtlState.buttons                           */
+#define VEX_CTL_BTN_MASK( index )   (1 << (((index) & 0x7F) - Btn8D))
+
+/** @brief  Number of buttons on each transmitter                              */
+#define VEX_CTL_BTN_NUM             12
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Button events generated by the frame decoder                       */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kVexCtlEventPress = 0,
+    kVexCtlEventRelease,
+    kVexCtlEventHold
+} tVexCtlEventType;
+
+typedef struct {
+    uint8_t     type;           ///< tVexCtlEventType
+    uint8_t     index;          ///< button as tCtlIndex, eg. Btn8U or Btn8UXmtr2
+    systime_t   time;           ///< system time of the frame
+} vexCtlEvent;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Each task that wants events needs its own reader                   */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t    seq;            ///< next event to read
+    uint32_t    lost;           ///< events overwritten before they were read
+} vexCtlEventReader;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Input shaping for an analog channel                                */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Applied in the order deadband, expo, scale and then invert.  Outside the
+ *  deadband the output is rescaled so it still reaches full range, expo
+ *  blends between a linear (0) and cubic (100) response.
+ */
+typedef struct {
+    uint8_t     deadband;       ///< values this close to center give 0
+    uint8_t     expo;           ///< 0 for linear to 100 for cubic
+    uint8_t     scale;          ///< output in percent, 100 for full range
+    bool_t      invert;         ///< reverse the channel
+} vexCtlShape;
+
+/** @brief  Events kept by the decoder, must be a power of 2                   */
+#if !defined(VEX_CTL_EVENT_QUEUE_SIZE)
+#define VEX_CTL_EVENT_QUEUE_SIZE    32
+#endif
+
+/** @brief  Time a button is pressed before a hold event is sent               */
+#if !defined(VEX_CTL_HOLD_MS)
+#define VEX_CTL_HOLD_MS             500
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -105,6 +174,15 @@ int16_t     vexControllerCompetitionStateSet( uint16_t ctl, int16_t mask );
 uint16_t    vexControllerCompetitonState(void);
 void        vexControllerReleaseWait( tCtlIndex index );
 
+void        vexControllerInit( void );
+void        vexControllerUpdate( void );
+void        vexControllerShapeSet( tCtlIndex index, const vexCtlShape *shape );
+int16_t     vexControllerShapedGet( tCtlIndex index );
+const vexCtlState *vexControllerStateGet( int16_t xmtr );
+void        vexControllerEventReaderInit( vexCtlEventReader *r );
+bool_t      vexControllerEventGet( vexCtlEventReader *r, vexCtlEvent *ev, systime_t timeout );
+void        vexControllerDebug(vexStream *chp, int argc, char *argv[]);
+
 #ifdef __cplusplus
 }
 #endif
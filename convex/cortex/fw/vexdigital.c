@@ -158,32 +158,120 @@ vexDigitalPinGet( tVexDigitalPin pin )
 
 
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Map from EXTI line (pad) to digital pin                        */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Each EXTI line can only be connected to one GPIO port so there is at most
+ *  one pin for each pad, -1 if that pad does not have a pin interrupt.
+ */
+static  int8_t      vexioPadPin[16] = {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Edge history for each pin with an interrupt                    */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    vexDigitalEdge  edges[VEX_DIGITAL_EDGE_BUFFER];
+    uint32_t        seq;            ///< number of edges recorded
+    uint32_t        debounce;       ///< uS to ignore edges after an edge
+} vexDigitalEdgeRing;
+
+#define EDGE_MASK   (VEX_DIGITAL_EDGE_BUFFER - 1)
+
+static  vexDigitalEdgeRing  vexioEdges[ kVexDigital_Num ];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get system time in uS                                          */
+/** @returns    time in uS, wraps after about 71 minutes                       */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  System tick count plus the position of the SysTick counter within the
+ *  current tick.  If the tick has wrapped but the interrupt is still pending
+ *  the tick count is one behind so it is adjusted here.  Must be called with
+ *  interrupts locked.
+ */
+static uint32_t
+_vexDigitalTimeUsI(void)
+{
+    systime_t   t = chTimeNow();
+    uint32_t    v = SysTick->VAL;
+
+    if( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk )
+        {
+        v = SysTick->VAL;
+        t++;
+        }
+
+    return( (t * (1000000 / CH_FREQUENCY)) +
+            ((SysTick->LOAD - v) / (halGetCounterFrequency() / 1000000)) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get system time in uS                                          */
+/** @returns    time in uS on the same clock as the edge timestamps            */
+/*-----------------------------------------------------------------------------*/
+
+uint32_t
+vexDigitalTimeUs()
+{
+    uint32_t    t;
+
+    chSysLock();
+    t = _vexDigitalTimeUsI();
+    chSysUnlock();
+
+    return( t );
+}
+
 /*-----------------------------------------------------------------------------*/
 /*  Callback for digital interrupt                                             */
 /*-----------------------------------------------------------------------------*/
 
-static void
+static VEX_RAMTEXT void
 _vi_cb(EXTDriver *extp, expchannel_t channel)
 {
+    vexDigitalEdgeRing  *r;
+    vexDigitalEdge      *e;
+    ioDef               *io;
+    uint32_t            now;
+    uint32_t            last;
+    int16_t             pin;
+
     (void)extp;
-    (void)channel;
+
+    VEX_ISR_ENTER();
 
     chSysLockFromIsr();
 
-    int pin;
-    for(pin=0;pin<kVexDigital_Num;pin++)
+    if( channel < 16 && (pin = vexioPadPin[ channel ]) >= 0 )
         {
-        if( vexioDefinition[pin].pad == (int16_t)channel )
+        io = &vexioDefinition[ pin ];
+        r  = &vexioEdges[ pin ];
+        now = _vexDigitalTimeUsI();
+        last = r->edges[ (r->seq - 1) & EDGE_MASK ].time;
+
+        // the tick adjustment can be wrong by one tick near a wrap of the
+        // SysTick counter, never go back before the previous edge
+        if( r->seq != 0 && (int32_t)(now - last) < 0 )
+            now = last;
+
+        // edges inside the debounce window are dropped
+        if( r->seq == 0 || r->debounce == 0 || (now - last) >= r->debounce )
             {
-            if( vexioDefinition[pin].intrCount >= 0 )
-                {
-                vexioDefinition[pin].intrCount++;
-                break;
-                }
+            e = &r->edges[ r->seq & EDGE_MASK ];
+            e->time  = now;
+            e->level = palReadPad( io->port, io->pad );
+            r->seq++;
+
+            io->intrCount++;
             }
         }
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrDigital );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -191,12 +279,16 @@ _vi_cb(EXTDriver *extp, expchannel_t channel)
 /** @param[in]  pin The pin                                                    */
 /*-----------------------------------------------------------------------------*/
 /** @details
- *  This is used for testing at present, the interrupt just increments a counter
+ *  Every edge is counted and recorded with a uS timestamp and the new level,
+ *  see vexDigitalEdgeGet.
  */
 
 void
 vexDigitalIntrSet( tVexDigitalPin pin )
 {
+    if( pin > kVexDigital_12 )
+        return;
+
     vexDigitalModeSet( pin, kVexDigitalInput );
     vexExtSet( vexioDefinition[pin].port, vexioDefinition[pin].pad, EXT_CH_MODE_BOTH_EDGES, _vi_cb );
 
@@ -209,7 +301,9 @@ vexDigitalIntrSet( tVexDigitalPin pin )
             vexioDefinition[kVexDigital_4].intrCount = -1;
         }
 
+    vexioEdges[pin].seq = 0;
     vexioDefinition[pin].intrCount = 0;
+    vexioPadPin[ vexioDefinition[pin].pad ] = pin;
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -244,3 +338,135 @@ vexDigitalIntrCountGet( tVexDigitalPin pin )
     return( vexioDefinition[pin].intrCount );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the debounce time for a digital pin interrupt              */
+/** @param[in]  pin The pin                                                    */
+/** @param[in]  us time in uS to ignore further edges after an edge           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Edges that occur within the debounce time of the last recorded edge are
+ *  neither counted nor recorded, 0 (the default) disables debounce.
+ */
+void
+vexDigitalIntrDebounceSet( tVexDigitalPin pin, uint32_t us )
+{
+    if( pin > kVexDigital_12 )
+        return;
+
+    vexioEdges[pin].debounce = us;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the next edge recorded on a digital pin                    */
+/** @param[in]  pin The pin                                                    */
+/** @param[in,out] seq the reader position, start at 0 or the value from       */
+/**             vexDigitalEdgeSeqGet to ignore older edges                     */
+/** @param[out] edge storage for the edge                                      */
+/** @returns    TRUE if an edge was returned                                   */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The ring buffer keeps the most recent VEX_DIGITAL_EDGE_BUFFER edges, if
+ *  the reader has fallen further behind than that it skips to the oldest
+ *  edge still available.
+ */
+bool_t
+vexDigitalEdgeGet( tVexDigitalPin pin, uint32_t *seq, vexDigitalEdge *edge )
+{
+    vexDigitalEdgeRing  *r;
+    bool_t              ok = FALSE;
+
+    if( pin > kVexDigital_12 )
+        return( FALSE );
+
+    r = &vexioEdges[pin];
+
+    chSysLock();
+    if( *seq != r->seq )
+        {
+        if( (r->seq - *seq) > VEX_DIGITAL_EDGE_BUFFER )
+            *seq = r->seq - VEX_DIGITAL_EDGE_BUFFER;
+
+        *edge = r->edges[ *seq & EDGE_MASK ];
+        *seq  = *seq + 1;
+        ok = TRUE;
+        }
+    chSysUnlock();
+
+    return( ok );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the most recent edge recorded on a digital pin             */
+/** @param[in]  pin The pin                                                    */
+/** @param[out] edge storage for the edge                                      */
+/** @returns    TRUE if there has been an edge                                 */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexDigitalEdgeLastGet( tVexDigitalPin pin, vexDigitalEdge *edge )
+{
+    uint32_t    seq;
+
+    if( pin > kVexDigital_12 || vexioEdges[pin].seq == 0 )
+        return( FALSE );
+
+    seq = vexioEdges[pin].seq - 1;
+
+    return( vexDigitalEdgeGet( pin, &seq, edge ) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the number of edges recorded on a digital pin             */
+/** @param[in]  pin The pin                                                    */
+/*-----------------------------------------------------------------------------*/
+
+uint32_t
+vexDigitalEdgeSeqGet( tVexDigitalPin pin )
+{
+    if( pin > kVexDigital_12 )
+        return( 0 );
+
+    return( vexioEdges[pin].seq );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show digital pin interrupt counts and edges                    */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexDigitalIntrDebug(vexStream *chp, int argc, char *argv[])
+{
+    vexDigitalEdge  edge, prev;
+    uint32_t        seq;
+    int16_t         pin;
+
+    (void)argc;
+    (void)argv;
+
+    vex_chprintf( chp, "pin  count debounce     last lvl interval\r\n" );
+    for(pin=0;pin<kVexDigital_Num;pin++)
+        {
+        if( vexioDefinition[pin].intrCount < 0 )
+            continue;
+
+        vex_chprintf( chp, "%3d %6d %8d", pin+1, vexioDefinition[pin].intrCount, vexioEdges[pin].debounce );
+
+        // last two edges give the most recent interval
+        seq = vexDigitalEdgeSeqGet( pin );
+        if( seq >= 2 )
+            {
+            seq -= 2;
+            vexDigitalEdgeGet( pin, &seq, &prev );
+            vexDigitalEdgeGet( pin, &seq, &edge );
+            vex_chprintf( chp, " %8d %3d %8d\r\n", edge.time, edge.level, edge.time - prev.time );
+            }
+        else
+        if( vexDigitalEdgeLastGet( pin, &edge ) )
+            vex_chprintf( chp, " %8d %3d\r\n", edge.time, edge.level );
+        else
+            vex_chprintf( chp, "\r\n" );
+        }
+}
@@ -182,6 +182,19 @@ typedef struct _ioDef {
     int32_t         intrCount;
 } ioDef;
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      An edge recorded by the digital pin interrupt                  */
+/*-----------------------------------------------------------------------------*/
+typedef struct _vexDigitalEdge {
+    uint32_t        time;           ///< time of the edge in uS
+    uint8_t         level;          ///< pin level after the edge
+} vexDigitalEdge;
+
+/** @brief  Edges kept for each pin, must be a power of 2                      */
+#if !defined(VEX_DIGITAL_EDGE_BUFFER)
+#define VEX_DIGITAL_EDGE_BUFFER     8
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -198,6 +211,12 @@ tVexDigitalState    vexDigitalPinGet( tVexDigitalPin pin );
 void                vexDigitalIntrSet( tVexDigitalPin pin );
 void                vexDigitalIntrRun(void);
 int32_t             vexDigitalIntrCountGet( tVexDigitalPin pin );
+void                vexDigitalIntrDebounceSet( tVexDigitalPin pin, uint32_t us );
+bool_t              vexDigitalEdgeGet( tVexDigitalPin pin, uint32_t *seq, vexDigitalEdge *edge );
+bool_t              vexDigitalEdgeLastGet( tVexDigitalPin pin, vexDigitalEdge *edge );
+uint32_t            vexDigitalEdgeSeqGet( tVexDigitalPin pin );
+uint32_t            vexDigitalTimeUs( void );
+void                vexDigitalIntrDebug(vexStream *chp, int argc, char *argv[]);
 
 // External interrupts
 void                vexExtIrqInit(void);
@@ -103,165 +103,205 @@ vexEncoderIrqServiceB( vexQuadEncoder_t *enc )
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_1_cb_a(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceA( &vexQuadEncoders[kVexQuadEncoder_1] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_1_cb_b(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceB( &vexQuadEncoders[kVexQuadEncoder_1] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_2_cb_a(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceA( &vexQuadEncoders[kVexQuadEncoder_2] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_2_cb_b(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceB( &vexQuadEncoders[kVexQuadEncoder_2] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_3_cb_a(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceA( &vexQuadEncoders[kVexQuadEncoder_3] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_3_cb_b(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceB( &vexQuadEncoders[kVexQuadEncoder_3] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
-static void
+static VEX_RAMTEXT void
 _vqe_4_cb_a(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceA( &vexQuadEncoders[kVexQuadEncoder_4] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_4_cb_b(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceB( &vexQuadEncoders[kVexQuadEncoder_4] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
-static void
+static VEX_RAMTEXT void
 _vqe_5_cb_a(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceA( &vexQuadEncoders[kVexQuadEncoder_5] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
 /*                                                                             */
 
-static void
+static VEX_RAMTEXT void
 _vqe_5_cb_b(EXTDriver *extp, expchannel_t channel)
 {
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // service encoder
     vexEncoderIrqServiceB( &vexQuadEncoders[kVexQuadEncoder_5] );
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrEncoder );
 }
 
 /*-----------------------------------------------------------------------------*/
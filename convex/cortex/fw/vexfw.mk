@@ -17,6 +17,10 @@ VEXFWSRC = ${CONVEX}/fw/vexshell.c \
            ${CONVEX}/fw/vexrttl.c \
            ${CONVEX}/fw/vexsensor.c \
            ${CONVEX}/fw/vexbkup.c \
+           ${CONVEX}/fw/vexboot.c \
+           ${CONVEX}/fw/vexperf.c \
+           ${CONVEX}/fw/vexisr.c \
+           ${CONVEX}/fw/vexstack.c \
            ${CONVEX}/fw/vextest.c
 
 # Required include directories
@@ -256,6 +256,10 @@ vexImeTask( void *arg )
             {
             // find encoders
             vexIMEFindEncoders();
+            // with none found keep looking, late IMEs can still be used
+            // by vexUserInit until the boot timeout
+            if( vexImes.num > 0 )
+                vexBootMark( kVexBootImeReady );
 
             // Show debug
             if(vexImes.debug)
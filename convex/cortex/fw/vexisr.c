@@ -0,0 +1,296 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexisr.c                                                     */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Optional timing of the interrupt handlers using the DWT cycle counter.  */
+/*    Enable with VEX_ISR_PROFILE_ENABLE, the handlers call VEX_ISR_ENTER and  */
+/*    VEX_ISR_EXIT which compile to nothing when it is not defined.           */
+/*                                                                             */
+/*    Each handler keeps a log2 histogram of its duration, the worst case     */
+/*    with when it happened and how deeply it was nested, and the shortest     */
+/*    time between two entries which shows how closely edges arrive.          */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexisr.c
+  * @brief   Interrupt handler timing
+*//*---------------------------------------------------------------------------*/
+
+static const char *vexIsrNames[kVexIsrNum] = {
+    "encoder",
+    "digital",
+    "sonar",
+    "motor pwm",
+    "spi timer"
+};
+
+static  vexIsrStats     vexIsrData[kVexIsrNum];
+static  volatile uint32_t vexIsrDepth = 0;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Change the interrupt nesting depth                             */
+/** @param[in]  delta +1 on entry, -1 on exit                                  */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Handlers at a higher priority than the kernel are not masked by
+ *  chSysLockFromIsr so the update uses LDREX/STREX, the exclusive monitor
+ *  is cleared on exception entry and exit so a nested handler forces a
+ *  retry.
+ */
+
+static void
+_vexIsrDepthAdd( int32_t delta )
+{
+    uint32_t    depth;
+
+    do  {
+        depth = __LDREXW( &vexIsrDepth ) + delta;
+        } while( __STREXW( depth, &vexIsrDepth ) != 0 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called on entry to an interrupt handler                        */
+/** @returns    The cycle counter                                              */
+/*-----------------------------------------------------------------------------*/
+
+uint32_t
+vexIsrEnter()
+{
+    _vexIsrDepthAdd( 1 );
+    return( halGetCounterValue() );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called on exit from an interrupt handler                       */
+/** @param[in]  isr the handler                                                */
+/** @param[in]  t0 the cycle counter on entry                                  */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  A handler cannot preempt itself so the statistics for each handler are
+ *  only written by one context at a time.
+ */
+
+void
+vexIsrExit( tVexIsr isr, uint32_t t0 )
+{
+    uint32_t    cycles = halGetCounterValue() - t0;
+    uint32_t    depth = vexIsrDepth;
+    vexIsrStats *s;
+    int16_t     b;
+
+    if( isr >= kVexIsrNum )
+        {
+        _vexIsrDepthAdd( -1 );
+        return;
+        }
+
+    s = &vexIsrData[isr];
+
+    s->count++;
+    s->cycles += cycles;
+
+    if( cycles > s->max )
+        {
+        s->max       = cycles;
+        s->max_time  = t0;
+        s->max_depth = depth;
+        }
+    if( depth > 1 )
+        s->nested++;
+
+    if( s->count > 1 && (s->min_gap == 0 || (t0 - s->last_entry) < s->min_gap) )
+        s->min_gap = t0 - s->last_entry;
+    s->last_entry = t0;
+
+    // log2 bucket, clz is a single instruction on the cortex-m3
+    b = (cycles == 0) ? 0 : 31 - __builtin_clz( cycles );
+    if( b >= VEX_ISR_BUCKETS )
+        b = VEX_ISR_BUCKETS - 1;
+    s->hist[b]++;
+
+    _vexIsrDepthAdd( -1 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Clear all interrupt statistics                                 */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexIsrReset()
+{
+    int16_t     i;
+
+    for(i=0;i<kVexIsrNum;i++)
+        {
+        chSysLock();
+        memset( &vexIsrData[i], 0, sizeof(vexIsrStats) );
+        chSysUnlock();
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Generate a burst of encoder interrupts                         */
+/** @param[in]  n the number of edges on each enabled line                     */
+/** @returns    The number of edges generated                                  */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Uses the software interrupt event register to pend every EXT line that
+ *  has its interrupt enabled, all lines at once so the handlers stack up
+ *  as they would with fast encoders.  This will change encoder counts.
+ *  A line that is enabled in the EXTI but not in the NVIC is never cleared
+ *  so each edge is given 1mS before the burst is abandoned.
+ */
+
+static int32_t
+_vexIsrBurst( int32_t n )
+{
+    uint32_t    lines = EXTI->IMR & 0xFFFF;
+    uint32_t    timeout = halGetCounterFrequency() / 1000;
+    uint32_t    t0;
+    int32_t     i;
+
+    for(i=0;i<n;i++)
+        {
+        EXTI->SWIER = lines;
+        // let the handlers run before the next edge
+        t0 = halGetCounterValue();
+        while( EXTI->PR & lines )
+            {
+            if( (halGetCounterValue() - t0) > timeout )
+                {
+                // clear whatever is still pending
+                EXTI->PR = lines;
+                return( i );
+                }
+            }
+        }
+
+    return( n );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show interrupt timing                                          */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  isr             - show statistics
+ *  isr reset       - clear statistics
+ *  isr burst [n]   - clear, pend all enabled EXT lines n times (default 1000)
+ *                    and show statistics
+ */
+
+void
+vexIsrDebug(vexStream *chp, int argc, char *argv[])
+{
+    int16_t     i, b;
+    vexIsrStats s;
+
+#ifndef VEX_ISR_PROFILE_ENABLE
+    (void)argc;
+    (void)argv;
+    (void)b;
+    (void)s;
+    (void)i;
+    vex_chprintf(chp, "isr profiling not enabled, define VEX_ISR_PROFILE_ENABLE\r\n");
+    return;
+#else
+    if( argc > 0 && strcmp( argv[0], "reset" ) == 0 )
+        {
+        vexIsrReset();
+        return;
+        }
+    if( argc > 0 && strcmp( argv[0], "burst" ) == 0 )
+        {
+        int32_t n = (argc > 1) ? atoi( argv[1] ) : 1000;
+
+        vexIsrReset();
+        if( _vexIsrBurst( n ) < n )
+            vex_chprintf(chp, "burst timeout, EXT line not serviced, check NVIC\r\n");
+        }
+
+    vex_chprintf(chp, "handler       count   avg   max  at (cycles)  depth nested mingap\r\n");
+    for(i=0;i<kVexIsrNum;i++)
+        {
+        chSysLock();
+        s = vexIsrData[i];
+        chSysUnlock();
+
+        if( s.count == 0 )
+            continue;
+
+        vex_chprintf(chp, "%-10s %8d %5d %5d %12u %5d %6d %6d\r\n", vexIsrNames[i], s.count,
+            s.cycles / s.count, s.max, s.max_time, s.max_depth, s.nested,
+            (s.count > 1) ? s.min_gap : 0 );
+        }
+
+    vex_chprintf(chp, "\r\nlog2(cycles)");
+    for(b=4;b<VEX_ISR_BUCKETS;b++)
+        vex_chprintf(chp, "%6d", b );
+    vex_chprintf(chp, "\r\n");
+    for(i=0;i<kVexIsrNum;i++)
+        {
+        if( vexIsrData[i].count == 0 )
+            continue;
+
+        // buckets below 16 cycles are not possible, fold them into 16
+        vex_chprintf(chp, "%-10s  ", vexIsrNames[i] );
+        for(b=4;b<VEX_ISR_BUCKETS;b++)
+            vex_chprintf(chp, "%6d", (b == 4) ? vexIsrData[i].hist[0] + vexIsrData[i].hist[1] +
+                                                 vexIsrData[i].hist[2] + vexIsrData[i].hist[3] +
+                                                 vexIsrData[i].hist[4] : vexIsrData[i].hist[b] );
+        vex_chprintf(chp, "\r\n");
+        }
+    vex_chprintf(chp, "cycles at %d MHz\r\n", halGetCounterFrequency() / 1000000 );
+#endif
+}
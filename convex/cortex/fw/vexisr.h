@@ -0,0 +1,118 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexisr.h                                                     */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __VEXISR__
+#define __VEXISR__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexisr.h
+  * @brief   Interrupt handler timing, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+// Uncomment (or define in the project Makefile) to time interrupt handlers
+//#define     VEX_ISR_PROFILE_ENABLE  1
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Number of log2 histogram buckets                               */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Bucket n counts handlers that took from 2^n to 2^(n+1)-1 cycles, the last
+ *  bucket counts anything longer.
+ */
+#define VEX_ISR_BUCKETS     16
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Instrumented interrupt handlers                                */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kVexIsrEncoder = 0,         ///< quad encoder EXT callbacks
+    kVexIsrDigital,             ///< digital pin interrupt EXT callback
+    kVexIsrSonar,               ///< sonar echo EXT callback
+    kVexIsrMotorPwm,            ///< motor 1 and 10 pwm timer
+    kVexIsrSpiTimer,            ///< spi delay GPT callback
+
+    kVexIsrNum
+    } tVexIsr;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Timing for one interrupt handler                               */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t    count;
+    uint32_t    cycles;         ///< total cycles, wraps
+    uint32_t    max;            ///< worst case cycles
+    uint32_t    max_time;       ///< cycle counter when worst case occurred
+    uint16_t    max_depth;      ///< nesting depth when worst case occurred
+    uint32_t    nested;         ///< times entered while another handler was running
+    uint32_t    last_entry;     ///< cycle counter at last entry
+    uint32_t    min_gap;        ///< shortest time between entries
+    uint32_t    hist[VEX_ISR_BUCKETS];
+    } vexIsrStats;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Macros used in the handlers                                    */
+/*-----------------------------------------------------------------------------*/
+#ifdef  VEX_ISR_PROFILE_ENABLE
+#define VEX_ISR_ENTER()         uint32_t _vex_isr_t0 = vexIsrEnter()
+#define VEX_ISR_EXIT( v )       vexIsrExit( (v), _vex_isr_t0 )
+#else
+#define VEX_ISR_ENTER()
+#define VEX_ISR_EXIT( v )
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t    vexIsrEnter( void );
+void        vexIsrExit( tVexIsr isr, uint32_t t0 );
+void        vexIsrReset( void );
+void        vexIsrDebug(vexStream *chp, int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __VEXISR__
@@ -50,6 +50,7 @@
 *//*---------------------------------------------------------------------------*/
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "ch.h"         // needs for all ChibiOS programs
 #include "hal.h"        // hardware abstraction layer header
@@ -59,9 +60,128 @@
 // We tested this on a different board without access to timer4
 static  TIM_TypeDef *PwmTimer = NULL;
 
+// actual pwm frequency of the timer
+static  uint32_t    PwmFreq = 0;
+// timer counts in one pwm period
+static  uint32_t    PwmPeriod = VEX_MOTOR_PWM_MAX;
+
 // storage for motor data
 static  vexMotor  vexMotors[kVexMotorNum];
 
+// Motor response linearization, indexed by motor type - 1
+// Each entry is the command needed for a speed of index/127 of free speed.
+// First set is for ports 1 and 10, the second for ports 2 through 9 where
+// the MC29 reaches full speed at a command of about 90.
+// Tables are from a fitted response curve, for index i > 0
+//   lut[i] = min( 127, round( d + (k - d) * (i/127) ^ (1/g) ) ),  lut[127] = 127
+// d is the deadband, k the command where speed saturates and g the
+// response exponent.
+//             ports 1 and 10         ports 2 to 9
+//   type      d     k     g          d     k     g
+//   269       6   127  0.85          8   100  0.80
+//   393T      8   127  0.80         10    92  0.75
+//   393S      8   127  0.78         10    90  0.72
+//   393R     10   127  0.75         12    88  0.70
+// Regenerate with the same formula if you have better measurements.
+static const uint8_t vexMotorLinLut[2][4][128] = {
+    {
+    // 269
+    {
+      0,   6,   7,   7,   8,   9,   9,  10,  11,  11,  12,  13,  14,  14,  15,  16,
+     17,  17,  18,  19,  20,  21,  21,  22,  23,  24,  25,  26,  26,  27,  28,  29,
+     30,  31,  32,  33,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,
+     45,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  58,  59,
+     60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,
+     76,  77,  78,  79,  80,  81,  82,  84,  85,  86,  87,  88,  89,  90,  91,  92,
+     93,  94,  95,  96,  97,  98,  99, 101, 102, 103, 104, 105, 106, 107, 108, 109,
+    110, 111, 113, 114, 115, 116, 117, 118, 119, 120, 121, 123, 124, 125, 126, 127
+    },
+    // 393T
+    {
+      0,   8,   9,   9,  10,  10,  11,  11,  12,  12,  13,  14,  14,  15,  16,  16,
+     17,  18,  18,  19,  20,  21,  21,  22,  23,  24,  24,  25,  26,  27,  28,  28,
+     29,  30,  31,  32,  33,  33,  34,  35,  36,  37,  38,  39,  40,  41,  41,  42,
+     43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  58,
+     59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,
+     75,  76,  77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  88,  89,  90,  91,
+     92,  93,  94,  95,  96,  97,  98, 100, 101, 102, 103, 104, 105, 106, 107, 109,
+    110, 111, 112, 113, 114, 115, 117, 118, 119, 120, 121, 122, 123, 125, 126, 127
+    },
+    // 393S
+    {
+      0,   8,   9,   9,   9,  10,  10,  11,  11,  12,  13,  13,  14,  14,  15,  16,
+     16,  17,  18,  18,  19,  20,  21,  21,  22,  23,  24,  24,  25,  26,  27,  28,
+     28,  29,  30,  31,  32,  32,  33,  34,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  54,  55,  56,
+     57,  58,  59,  60,  61,  62,  63,  64,  65,  67,  68,  69,  70,  71,  72,  73,
+     74,  75,  76,  77,  78,  79,  80,  81,  82,  83,  85,  86,  87,  88,  89,  90,
+     91,  92,  93,  94,  96,  97,  98,  99, 100, 101, 102, 104, 105, 106, 107, 108,
+    109, 110, 112, 113, 114, 115, 116, 117, 119, 120, 121, 122, 123, 125, 126, 127
+    },
+    // 393R
+    {
+      0,  10,  10,  11,  11,  12,  12,  12,  13,  13,  14,  14,  15,  16,  16,  17,
+     17,  18,  19,  19,  20,  21,  21,  22,  23,  23,  24,  25,  26,  26,  27,  28,
+     29,  29,  30,  31,  32,  33,  33,  34,  35,  36,  37,  38,  38,  39,  40,  41,
+     42,  43,  44,  45,  46,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,
+     57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,
+     73,  74,  75,  76,  77,  78,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,
+     91,  92,  93,  94,  95,  96,  97,  98, 100, 101, 102, 103, 104, 105, 107, 108,
+    109, 110, 111, 112, 114, 115, 116, 117, 118, 120, 121, 122, 123, 125, 126, 127
+    }
+    },
+    {
+    // 269
+    {
+      0,   8,   9,   9,   9,  10,  10,  10,  11,  11,  12,  12,  13,  13,  14,  14,
+     15,  15,  16,  17,  17,  18,  18,  19,  19,  20,  21,  21,  22,  23,  23,  24,
+     24,  25,  26,  26,  27,  28,  28,  29,  30,  30,  31,  32,  32,  33,  34,  35,
+     35,  36,  37,  37,  38,  39,  40,  40,  41,  42,  43,  43,  44,  45,  46,  46,
+     47,  48,  49,  49,  50,  51,  52,  52,  53,  54,  55,  56,  56,  57,  58,  59,
+     60,  60,  61,  62,  63,  64,  65,  65,  66,  67,  68,  69,  69,  70,  71,  72,
+     73,  74,  75,  75,  76,  77,  78,  79,  80,  81,  81,  82,  83,  84,  85,  86,
+     87,  88,  88,  89,  90,  91,  92,  93,  94,  95,  95,  96,  97,  98,  99, 127
+    },
+    // 393T
+    {
+      0,  10,  10,  11,  11,  11,  11,  12,  12,  12,  13,  13,  14,  14,  14,  15,
+     15,  16,  16,  17,  17,  17,  18,  18,  19,  19,  20,  20,  21,  21,  22,  23,
+     23,  24,  24,  25,  25,  26,  26,  27,  28,  28,  29,  29,  30,  31,  31,  32,
+     32,  33,  34,  34,  35,  36,  36,  37,  38,  38,  39,  40,  40,  41,  42,  42,
+     43,  44,  44,  45,  46,  46,  47,  48,  48,  49,  50,  51,  51,  52,  53,  54,
+     54,  55,  56,  57,  57,  58,  59,  60,  60,  61,  62,  63,  63,  64,  65,  66,
+     66,  67,  68,  69,  70,  70,  71,  72,  73,  74,  74,  75,  76,  77,  78,  79,
+     79,  80,  81,  82,  83,  84,  84,  85,  86,  87,  88,  89,  89,  90,  91, 127
+    },
+    // 393S
+    {
+      0,  10,  10,  10,  11,  11,  11,  11,  12,  12,  12,  13,  13,  13,  14,  14,
+     15,  15,  15,  16,  16,  17,  17,  17,  18,  18,  19,  19,  20,  20,  21,  21,
+     22,  22,  23,  23,  24,  24,  25,  26,  26,  27,  27,  28,  28,  29,  30,  30,
+     31,  31,  32,  33,  33,  34,  34,  35,  36,  36,  37,  38,  38,  39,  40,  40,
+     41,  42,  42,  43,  44,  44,  45,  46,  46,  47,  48,  48,  49,  50,  51,  51,
+     52,  53,  54,  54,  55,  56,  57,  57,  58,  59,  60,  60,  61,  62,  63,  63,
+     64,  65,  66,  67,  67,  68,  69,  70,  71,  71,  72,  73,  74,  75,  76,  76,
+     77,  78,  79,  80,  81,  81,  82,  83,  84,  85,  86,  87,  87,  88,  89, 127
+    },
+    // 393R
+    {
+      0,  12,  12,  12,  13,  13,  13,  13,  13,  14,  14,  14,  15,  15,  15,  16,
+     16,  16,  17,  17,  17,  18,  18,  19,  19,  19,  20,  20,  21,  21,  22,  22,
+     23,  23,  24,  24,  25,  25,  26,  26,  27,  27,  28,  28,  29,  29,  30,  30,
+     31,  31,  32,  33,  33,  34,  34,  35,  36,  36,  37,  37,  38,  39,  39,  40,
+     41,  41,  42,  42,  43,  44,  44,  45,  46,  46,  47,  48,  48,  49,  50,  51,
+     51,  52,  53,  53,  54,  55,  56,  56,  57,  58,  58,  59,  60,  61,  61,  62,
+     63,  64,  64,  65,  66,  67,  68,  68,  69,  70,  71,  71,  72,  73,  74,  75,
+     76,  76,  77,  78,  79,  80,  80,  81,  82,  83,  84,  85,  85,  86,  87, 127
+    }
+    }
+    };
+
+// filtered main battery voltage in mV << VEX_MOTOR_BATTERY_FILTER
+static  int32_t     vexMotorBattFilt = 0;
+static  uint16_t    vexMotorBattNominal = VEX_MOTOR_BATTERY_NOMINAL;
+
 // use only in interrupt
 // 0 and 9 are really motors 1 and 10
 // they are left at 0 and 9 for legacy reasons
@@ -70,6 +190,144 @@ static  int16_t   m0_new_value = 0;
 static  int16_t   m9_cur_value = 0;
 static  int16_t   m9_new_value = 0;
 
+// command mailbox, one slot per priority for each motor
+static  vexMotorCmd vexMotorCmds[kVexMotorNum][VEX_MOTOR_CMD_PRIORITIES];
+static  uint16_t    vexMotorCmdMaxAge[kVexMotorNum];
+// set while a motor is commanded through the mailbox
+static  bool_t      vexMotorCmdUsed[kVexMotorNum];
+// set when the owner of a slot exited without releasing it
+static  bool_t      vexMotorCmdAbandoned[kVexMotorNum];
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Arm the pwm interrupt after motor 1 or 10 changes              */
+/** @param[in]  index The motor index                                          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The interrupt runs at the next pwm period and disables itself again once
+ *  both motors have their new values, it stays armed for one more period
+ *  if a motor has to pass through 0 to change direction.
+ */
+static void
+_vexMotorPwmArm( int16_t index )
+{
+#if VEX_MOTOR_PWM_ON_CHANGE
+    if( (index != kVexMotor_1 && index != kVexMotor_10) || PwmTimer == NULL )
+        return;
+
+    chSysLock();
+    if( !(PwmTimer->DIER & TIM_DIER_UIE) )
+        {
+        // clear the stale update flag so we start on the next period
+        PwmTimer->SR    = ~TIM_SR_UIF;
+        PwmTimer->DIER |= TIM_DIER_UIE;
+        }
+    chSysUnlock();
+#else
+    (void)index;
+#endif
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Linearize a high resolution command                            */
+/** @param[in]  lut The response table for the motor                          */
+/** @param[in]  value The command (-VEX_MOTOR_PWM_MAX to VEX_MOTOR_PWM_MAX)    */
+/** @returns    The linearized command                                         */
+/*-----------------------------------------------------------------------------*/
+
+static int16_t
+_vexMotorLinearizeExt( const uint8_t *lut, int16_t value )
+{
+    int32_t x, i, frac, out;
+
+    // interpolate between table entries
+    x    = abs(value) * 127;
+    i    = x / VEX_MOTOR_PWM_MAX;
+    frac = x % VEX_MOTOR_PWM_MAX;
+
+    out = lut[i] * VEX_MOTOR_PWM_MAX;
+    if( i < 127 )
+        out += (lut[i+1] - lut[i]) * frac;
+    out /= 127;
+
+    return( (value < 0) ? -out : out );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Scale a command for battery voltage                            */
+/** @param[in]  m Pointer to the motor                                         */
+/** @param[in]  value The command                                              */
+/** @param[in]  max Full scale for the command                                 */
+/** @param[in]  vbat The filtered battery voltage in mV                        */
+/** @returns    The scaled command                                             */
+/*-----------------------------------------------------------------------------*/
+
+static int16_t
+_vexMotorBatteryScale( vexMotor *m, int16_t value, int16_t max, int32_t vbat )
+{
+    int32_t x;
+
+    x = ((int32_t)value * vexMotorBattNominal) / vbat;
+
+    if( x > max )
+        {
+        x = max;
+        m->saturated = TRUE;
+        }
+    else
+    if( x < -max )
+        {
+        x = -max;
+        m->saturated = TRUE;
+        }
+
+    return( x );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Calculate the output sent to a motor from the command          */
+/** @param[in]  index The motor index                                          */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_vexMotorOutputUpdate( int16_t index )
+{
+    vexMotor        *m = &vexMotors[ index ];
+    const uint8_t   *lut;
+    int16_t         out, out_ext;
+    int32_t         vbat;
+
+    out     = m->value;
+    out_ext = m->value_ext;
+
+    if( m->linearize && m->type != kVexMotorUndefined )
+        {
+        lut = vexMotorLinLut[ (index == kVexMotor_1 || index == kVexMotor_10) ? 0 : 1 ][ m->type - 1 ];
+
+        out     = (out < 0) ? -lut[ -out ] : lut[ out ];
+        out_ext = _vexMotorLinearizeExt( lut, out_ext );
+        }
+
+    // scale by nominal over actual battery, limit at full scale
+    m->saturated = FALSE;
+    vbat = vexMotorBatteryGet();
+    if( m->battcomp && vbat >= VEX_MOTOR_BATTERY_MIN )
+        {
+        out     = _vexMotorBatteryScale( m, out, 127, vbat );
+        out_ext = _vexMotorBatteryScale( m, out_ext, VEX_MOTOR_PWM_MAX, vbat );
+        }
+
+    if( m->output != out || m->output_ext != out_ext )
+        {
+        m->output     = out;
+        m->output_ext = out_ext;
+        _vexMotorPwmArm( index );
+        }
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Initialize the motors                                          */
 /*-----------------------------------------------------------------------------*/
@@ -82,10 +340,19 @@ vexMotorInit()
     for(i=kVexMotor_1;i<kVexMotorNum;i++)
         {
         vexMotors[i].value = 0;
+        vexMotors[i].value_ext = 0;
+        vexMotors[i].output = 0;
+        vexMotors[i].output_ext = 0;
         vexMotors[i].type  = kVexMotorUndefined;
         vexMotors[i].reversed = FALSE;
+        vexMotors[i].linearize = FALSE;
+        vexMotors[i].battcomp = FALSE;
+        vexMotors[i].saturated = FALSE;
         vexMotors[i].motorPositionGet = NULL;
         vexMotors[i].motorPositionSet = NULL;
+        vexMotorCmdMaxAge[i] = VEX_MOTOR_CMD_MAX_AGE;
+        vexMotorCmdUsed[i] = FALSE;
+        vexMotorCmdAbandoned[i] = FALSE;
         }
 
     // Initialize the two H-Bridge motor controllers
@@ -116,8 +383,309 @@ vexMotorSet( int16_t index, int16_t value )
     if( value < (-127))
         value = -127;
 
-    // save limited value in array
-    vexMotors[ index ].value = value;
+    // save limited value in array, value_ext is checked as well as
+    // vexMotorSetExt may have left a small output that rounds to 0
+    if( vexMotors[ index ].value != value ||
+        vexMotors[ index ].value_ext != (value * VEX_MOTOR_PWM_MAX) / 127 )
+        {
+        vexMotors[ index ].value = value;
+        vexMotors[ index ].value_ext = (value * VEX_MOTOR_PWM_MAX) / 127;
+        _vexMotorOutputUpdate( index );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set motor to speed with higher resolution                      */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  value The speed (-VEX_MOTOR_PWM_MAX to VEX_MOTOR_PWM_MAX)      */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Only ports 1 and 10 are driven directly by the cortex and can use the full
+ *  resolution, other ports are scaled to the normal -127 to 127 range.
+ *  vexMotorGet returns the scaled value for all ports.
+ */
+void
+vexMotorSetExt( int16_t index, int16_t value )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return;
+
+    // limit
+    if( value > VEX_MOTOR_PWM_MAX )
+        value = VEX_MOTOR_PWM_MAX;
+    else
+    if( value < (-VEX_MOTOR_PWM_MAX))
+        value = -VEX_MOTOR_PWM_MAX;
+
+    if( index != kVexMotor_1 && index != kVexMotor_10 )
+        {
+        vexMotorSet( index, (value * 127) / VEX_MOTOR_PWM_MAX );
+        return;
+        }
+
+    if( vexMotors[ index ].value_ext != value )
+        {
+        vexMotors[ index ].value_ext = value;
+        vexMotors[ index ].value = (value * 127) / VEX_MOTOR_PWM_MAX;
+        _vexMotorOutputUpdate( index );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the commanded speed of a motor with higher resolution      */
+/** @param[in]  index The motor index                                          */
+/** @returns    The speed (-VEX_MOTOR_PWM_MAX to VEX_MOTOR_PWM_MAX)            */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+vexMotorGetExt( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return 0;
+
+    if( index != kVexMotor_1 && index != kVexMotor_10 )
+        return( (vexMotors[ index ].value * VEX_MOTOR_PWM_MAX) / 127 );
+
+    return( vexMotors[ index ].value_ext );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the speed actually sent to a motor                         */
+/** @param[in]  index The motor index                                          */
+/** @returns    The output after linearization (-127 to 127)                   */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+vexMotorOutputGet( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return 0;
+
+    return( vexMotors[ index ].output );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the speed actually sent to a motor with higher resolution  */
+/** @param[in]  index The motor index                                          */
+/** @returns    The output (-VEX_MOTOR_PWM_MAX to VEX_MOTOR_PWM_MAX)           */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+vexMotorOutputGetExt( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return 0;
+
+    if( index != kVexMotor_1 && index != kVexMotor_10 )
+        return( (vexMotors[ index ].output * VEX_MOTOR_PWM_MAX) / 127 );
+
+    return( vexMotors[ index ].output_ext );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Enable linearization of the motor response                     */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  enable TRUE to use the response table for the motor type      */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The command is mapped through a table for the motor type set with
+ *  vexMotorTypeSet so that speed is close to proportional to the command,
+ *  nothing changes if the type is undefined.  Enabled by vexMotorTypeSet
+ *  when VEX_MOTOR_LINEARIZE_DEFAULT is TRUE, call after the type is set to
+ *  turn it off.  Do not combine with another linearization such as the
+ *  pidlib lut, the pidlib executor already skips its lut for these motors.
+ */
+void
+vexMotorLinearizeSet( int16_t index, bool_t enable )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return;
+
+    vexMotors[ index ].linearize = enable;
+    _vexMotorOutputUpdate( index );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the linearization flag for a motor                         */
+/** @param[in]  index The motor index                                          */
+/** @returns    TRUE if linearization is enabled                               */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexMotorLinearizeGet( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return( FALSE );
+
+    return( vexMotors[ index ].linearize );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Enable battery voltage compensation for a motor                */
+/** @param[in]  index The motor index                                         */
+/** @param[in]  enable TRUE to scale output by nominal over battery voltage    */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A command gives the same average motor voltage whatever the battery
+ *  level, as long as there is headroom.  With a full battery above the
+ *  nominal voltage the output is reduced, with a low battery it is
+ *  increased until full scale is reached and vexMotorSaturatedGet returns
+ *  TRUE.
+ */
+void
+vexMotorBatteryCompSet( int16_t index, bool_t enable )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return;
+
+    vexMotors[ index ].battcomp = enable;
+    _vexMotorOutputUpdate( index );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the battery compensation flag for a motor                  */
+/** @param[in]  index The motor index                                          */
+/** @returns    TRUE if battery compensation is enabled                        */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexMotorBatteryCompGet( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return( FALSE );
+
+    return( vexMotors[ index ].battcomp );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Check if compensated output could not reach the command        */
+/** @param[in]  index The motor index                                          */
+/** @returns    TRUE if the output was limited at full scale                   */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexMotorSaturatedGet( int16_t index )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return( FALSE );
+
+    return( vexMotors[ index ].saturated );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the nominal battery voltage for compensation               */
+/** @param[in]  mv The voltage in mV                                           */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexMotorBatteryNominalSet( uint16_t mv )
+{
+    if( mv < VEX_MOTOR_BATTERY_MIN )
+        return;
+
+    vexMotorBattNominal = mv;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the filtered main battery voltage                          */
+/** @returns    The battery voltage in mV                                      */
+/*-----------------------------------------------------------------------------*/
+
+uint16_t
+vexMotorBatteryGet()
+{
+    return( vexMotorBattFilt >> VEX_MOTOR_BATTERY_FILTER );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Filter the battery voltage and update compensated motors       */
+/** @note       Called by the system task before motor data is sent           */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexMotorBatteryUpdate()
+{
+    int32_t     vbat;
+    int16_t     i;
+
+    // no reading until the master cpu is online
+    if( (vbat = vexSpiGetMainBattery()) == 0 )
+        return;
+
+    // first reading primes the filter
+    if( vexMotorBattFilt == 0 )
+        vexMotorBattFilt = vbat << VEX_MOTOR_BATTERY_FILTER;
+    else
+        vexMotorBattFilt += vbat - (vexMotorBattFilt >> VEX_MOTOR_BATTERY_FILTER);
+
+    for(i=kVexMotor_1;i<kVexMotorNum;i++)
+        {
+        if( vexMotors[i].battcomp )
+            _vexMotorOutputUpdate( i );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the pwm frequency for ports 1 and 10                       */
+/** @param[in]  freq The frequency in Hz                                       */
+/** @returns    The frequency actually used                                    */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Both ports share one timer so they always use the same frequency.  The
+ *  smallest prescaler that keeps the period within the 16 bit timer is used
+ *  so the period has as many counts as possible, at least 4500 over the
+ *  allowed range.  Commands keep the VEX_MOTOR_PWM_MAX scale and are scaled
+ *  to the period when the compare registers are written.
+ */
+uint32_t
+vexMotorPwmFreqSet( uint32_t freq )
+{
+    uint32_t    counts;
+    uint32_t    psc;
+    uint32_t    period;
+
+    if( PwmTimer == NULL )
+        return( 0 );
+
+    if( freq < VEX_MOTOR_PWM_FREQ_MIN )
+        freq = VEX_MOTOR_PWM_FREQ_MIN;
+    if( freq > VEX_MOTOR_PWM_FREQ_MAX )
+        freq = VEX_MOTOR_PWM_FREQ_MAX;
+
+    // timer clocks in one period, split into prescaler and period
+    counts = (STM32_TIMCLK1 + (freq / 2)) / freq;
+    psc    = (counts + 65535) / 65536;
+    period = (counts + (psc / 2)) / psc;
+
+    // rescale the outputs, takes effect at the next update event
+    chSysLock();
+    PwmTimer->CCR1 = (PwmTimer->CCR1 * period) / PwmPeriod;
+    PwmTimer->CCR2 = (PwmTimer->CCR2 * period) / PwmPeriod;
+    PwmTimer->CCR3 = (PwmTimer->CCR3 * period) / PwmPeriod;
+    PwmTimer->CCR4 = (PwmTimer->CCR4 * period) / PwmPeriod;
+    PwmTimer->PSC  = psc - 1;
+    PwmTimer->ARR  = period - 1;
+    PwmPeriod = period;
+    chSysUnlock();
+
+    PwmFreq = STM32_TIMCLK1 / (psc * period);
+
+    return( PwmFreq );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the pwm frequency for a motor port                         */
+/** @param[in]  index The motor index                                          */
+/** @returns    The frequency in Hz or 0 if not driven by the cortex           */
+/*-----------------------------------------------------------------------------*/
+
+uint32_t
+vexMotorPwmFreqGet( int16_t index )
+{
+    if( index != kVexMotor_1 && index != kVexMotor_10 )
+        return( 0 );
+
+    return( PwmFreq );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -142,10 +710,295 @@ vexMotorGet( int16_t index )
 void
 vexMotorStopAll()
 {
-    int16_t i;
+    int16_t i, p;
 
     for(i=kVexMotor_1;i<kVexMotorNum;i++)
+        {
+        // drop any mailbox commands so they are not sent again
+        for(p=0;p<VEX_MOTOR_CMD_PRIORITIES;p++)
+            vexMotorCmds[i][p].owner = NULL;
+
         vexMotorSet( i, 0);
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called by the kernel when a thread exits                       */
+/** @param[in]  tp pointer to the exiting thread                               */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Runs from THREAD_EXT_EXIT_HOOK inside the kernel lock, before the thread
+ *  memory can be freed or reused.  Any mailbox slots it still owns are
+ *  cleared so a slot owner is always a live thread.
+ */
+
+void
+vexMotorThreadExit( void *tp )
+{
+    int16_t i, p;
+
+    for(i=kVexMotor_1;i<kVexMotorNum;i++)
+        {
+        for(p=0;p<VEX_MOTOR_CMD_PRIORITIES;p++)
+            {
+            if( vexMotorCmds[i][p].owner == (Thread *)tp )
+                {
+                vexMotorCmds[i][p].owner = NULL;
+                vexMotorCmdAbandoned[i] = TRUE;
+                }
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Check if a thread owns a mailbox command slot                  */
+/** @param[in]  cmd Pointer to the command slot                                */
+/** @param[in]  tp The thread                                                  */
+/** @returns    TRUE if tp owns the slot                                       */
+/*-----------------------------------------------------------------------------*/
+
+static bool_t
+_vexMotorCmdOwnedI( vexMotorCmd *cmd, Thread *tp )
+{
+    return( cmd->owner == tp );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Check if a mailbox command can no longer be used               */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  cmd Pointer to the command slot, must have an owner            */
+/** @returns    TRUE if the command is too old                                 */
+/*-----------------------------------------------------------------------------*/
+
+static bool_t
+_vexMotorCmdStaleI( int16_t index, vexMotorCmd *cmd )
+{
+    if( vexMotorCmdMaxAge[index] == 0 )
+        return( FALSE );
+
+    return( (systime_t)(chTimeNow() - cmd->time) > MS2ST(vexMotorCmdMaxAge[index]) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Send a command to a motor through the mailbox                  */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  value The speed of the motor (-127 to 127)                     */
+/** @param[in]  priority The command priority (0 to VEX_MOTOR_CMD_PRIORITIES-1)*/
+/** @returns    TRUE if the calling thread owns the slot                       */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Each priority is a slot that belongs to one thread at a time, the first
+ *  thread to write claims it and keeps it until it is released, it exits or
+ *  its command becomes older than the max age.  The motor is driven by the
+ *  highest priority slot holding a fresh command, this happens in the
+ *  system task just before the motor data is sent to the master cpu.
+ *  A thread must keep sending its command faster than the max age, if it
+ *  stops the motor decays to 0.  A thread that exits holding a slot stops
+ *  the motor.  Once no slot has an owner the motor is left to vexMotorSet.
+ */
+bool_t
+vexMotorCommandSet( int16_t index, int16_t value, int16_t priority )
+{
+    vexMotorCmd *cmd;
+    Thread      *tp;
+
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return( FALSE );
+    if( (priority < 0) || (priority >= VEX_MOTOR_CMD_PRIORITIES) )
+        return( FALSE );
+
+    // limit
+    if( value > 127 )
+        value = 127;
+    else
+    if( value < (-127))
+        value = -127;
+
+    cmd   = &vexMotorCmds[index][priority];
+    tp    = chThdSelf();
+
+    chSysLock();
+    if( !_vexMotorCmdOwnedI( cmd, tp ) )
+        {
+        // owned by a live thread that is still sending commands
+        if( cmd->owner != NULL && !_vexMotorCmdStaleI( index, cmd ) )
+            {
+            chSysUnlock();
+            return( FALSE );
+            }
+        cmd->owner = tp;
+        }
+
+    cmd->value = value;
+    cmd->time  = chTimeNow();
+    vexMotorCmdUsed[index] = TRUE;
+    chSysUnlock();
+
+    return( TRUE );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Release a mailbox slot owned by the calling thread             */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  priority The command priority                                  */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexMotorCommandRelease( int16_t index, int16_t priority )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return;
+    if( (priority < 0) || (priority >= VEX_MOTOR_CMD_PRIORITIES) )
+        return;
+
+    // only clears the slot if we still own it
+    chSysLock();
+    if( _vexMotorCmdOwnedI( &vexMotorCmds[index][priority], chThdSelf() ) )
+        vexMotorCmds[index][priority].owner = NULL;
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the age after which a mailbox command is ignored           */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  ms The max age in mS, 0 means commands never become stale      */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexMotorCommandMaxAgeSet( int16_t index, uint16_t ms )
+{
+    if( (index < kVexMotor_1) || (index >= kVexMotorNum))
+        return;
+
+    vexMotorCmdMaxAge[index] = ms;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Update motors from the mailbox                                 */
+/** @note       Called by the system task before motor data is sent           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Motors with no slot owned are left alone so vexMotorSet still works as
+ *  before, they are stopped once if the last owner exited without releasing
+ *  its slot.  When slots are owned but none holds a fresh command the motor
+ *  moves towards 0 by VEX_MOTOR_CMD_DECAY each tick.
+ */
+void
+vexMotorCommandUpdate()
+{
+    int16_t     i, p;
+    int16_t     value;
+    vexMotorCmd *cmd;
+    bool_t      owned;
+    bool_t      abandoned;
+
+    for(i=kVexMotor_1;i<kVexMotorNum;i++)
+        {
+        if( !vexMotorCmdUsed[i] )
+            continue;
+
+        // highest priority fresh command wins
+        owned = FALSE;
+        chSysLock();
+        for(p=VEX_MOTOR_CMD_PRIORITIES-1;p>=0;p--)
+            {
+            cmd = &vexMotorCmds[i][p];
+            if( cmd->owner == NULL )
+                continue;
+            owned = TRUE;
+            if( !_vexMotorCmdStaleI( i, cmd ) )
+                break;
+            }
+        if( p >= 0 )
+            value = vexMotorCmds[i][p].value;
+
+        // no owners, hand the motor back to vexMotorSet
+        abandoned = vexMotorCmdAbandoned[i];
+        vexMotorCmdAbandoned[i] = FALSE;
+        if( !owned )
+            vexMotorCmdUsed[i] = FALSE;
+        chSysUnlock();
+
+        if( !owned )
+            {
+            if( abandoned )
+                vexMotorSet( i, 0 );
+            continue;
+            }
+
+        if( p < 0 )
+            {
+            value = vexMotors[i].value;
+            if( value > VEX_MOTOR_CMD_DECAY )
+                value -= VEX_MOTOR_CMD_DECAY;
+            else
+            if( value < -VEX_MOTOR_CMD_DECAY )
+                value += VEX_MOTOR_CMD_DECAY;
+            else
+                value = 0;
+            }
+
+        vexMotorSet( i, value );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Command line debug of the motor mailbox                        */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexMotorCommandDebug(vexStream *chp, int argc, char *argv[])
+{
+    int16_t     i, p;
+    vexMotorCmd *cmd;
+    Thread      *tp;
+    const char  *name;
+    int16_t     value;
+    systime_t   age;
+    bool_t      stale;
+
+    if( argc == 2 )
+        {
+        // mbox <motor> <max age>
+        vexMotorCommandMaxAgeSet( atoi( argv[0] ), atoi( argv[1] ) );
+        return;
+        }
+
+    vex_chprintf(chp, "Motor  Out MaxAge Pri Owner            Cmd   Age\r\n");
+    for(i=kVexMotor_1;i<kVexMotorNum;i++)
+        {
+        if( !vexMotorCmdUsed[i] )
+            continue;
+
+        vex_chprintf(chp, "M_%-2d  %4d %6d\r\n", i, vexMotors[i].value, vexMotorCmdMaxAge[i] );
+        for(p=VEX_MOTOR_CMD_PRIORITIES-1;p>=0;p--)
+            {
+            cmd = &vexMotorCmds[i][p];
+
+            // copy under lock, the owner cannot exit while we hold it
+            chSysLock();
+            if( (tp = cmd->owner) != NULL )
+                {
+                name  = tp->p_name;
+                value = cmd->value;
+                age   = chTimeNow() - cmd->time;
+                stale = _vexMotorCmdStaleI( i, cmd );
+                }
+            chSysUnlock();
+
+            if( tp == NULL )
+                continue;
+
+            vex_chprintf(chp, "                 %3d %-16s %4d %5d%s\r\n", p,
+                (name != NULL) ? name : "-", value,
+                (age * 1000) / CH_FREQUENCY, stale ? " stale" : "" );
+            }
+        }
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -153,6 +1006,10 @@ vexMotorStopAll()
 /** @param[in]  index The motor index                                          */
 /** @param[in]  type The motor type                                            */
 /*-----------------------------------------------------------------------------*/
+/** @details
+ *  Also selects the response table used to linearize the output and, when
+ *  VEX_MOTOR_LINEARIZE_DEFAULT is TRUE, enables it.
+ */
 
 void
 vexMotorTypeSet( int16_t index, tVexMotorType type )
@@ -160,7 +1017,12 @@ vexMotorTypeSet( int16_t index, tVexMotorType type )
     if( (index < kVexMotor_1) || (index >= kVexMotorNum))
         return;
 
+    if( type < kVexMotorUndefined || type > kVexMotor393R )
+        type = kVexMotorUndefined;
+
     vexMotors[ index ].type = type;
+    vexMotors[ index ].linearize = VEX_MOTOR_LINEARIZE_DEFAULT && (type != kVexMotorUndefined);
+    _vexMotorOutputUpdate( index );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -191,6 +1053,7 @@ vexMotorDirectionSet( int16_t index, bool_t reversed )
         return;
 
     vexMotors[ index ].reversed = reversed;
+    _vexMotorPwmArm( index );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -356,16 +1219,47 @@ vexMotorDebug(vexStream *chp, int argc, char *argv[])
     if (argc < 2)
         {
         // Status
-        vex_chprintf(chp, "Motor  Speed  Position Rev   ID\r\n");
+        vex_chprintf(chp, "Motor  Speed  Out  Position Rev   ID\r\n");
         for(index=0;index<kVexMotorNum;index++)
             {
-            vex_chprintf(chp, "M_%d  %4d %7d      ", index, vexMotors[ index ].value, vexMotorPositionGet( index ) );
+            vex_chprintf(chp, "M_%d  %4d  %4d%c %7d      ", index, vexMotors[ index ].value, vexMotors[ index ].output,
+                vexMotors[ index ].linearize ? '*' : ' ', vexMotorPositionGet( index ) );
             if( vexMotors[ index ].reversed )
                 vex_chprintf(chp, "true  ");
             else
                 vex_chprintf(chp, "false ");
             vex_chprintf(chp,"%d\r\n", vexMotorEncoderIdGet(index));
             }
+        vex_chprintf(chp, "M_0 and M_9 pwm %dHz\r\n", PwmFreq );
+        vex_chprintf(chp, "battery %dmV nominal %dmV compensated", vexMotorBatteryGet(), vexMotorBattNominal );
+        for(index=0;index<kVexMotorNum;index++)
+            {
+            if( vexMotors[ index ].battcomp )
+                vex_chprintf(chp, " M_%d%s", index, vexMotors[ index ].saturated ? "(sat)" : "" );
+            }
+        vex_chprintf(chp, "\r\n");
+        }
+    else
+    if( strcmp( argv[0], "pwm" ) == 0 )
+        {
+        // change pwm frequency for the direct H-bridge ports
+        vex_chprintf(chp, "pwm set to %dHz\r\n", vexMotorPwmFreqSet( atoi( argv[1] ) ) );
+        }
+    else
+    if( strcmp( argv[0], "lin" ) == 0 && argc > 2 )
+        {
+        // motor lin <index> <0 or 1>
+        index = atoi( argv[1] );
+        vexMotorLinearizeSet( index, atoi( argv[2] ) ? TRUE : FALSE );
+        vex_chprintf(chp, "motor %d linearize %s\r\n", index, vexMotorLinearizeGet( index ) ? "on" : "off" );
+        }
+    else
+    if( strcmp( argv[0], "batt" ) == 0 && argc > 2 )
+        {
+        // motor batt <index> <0 or 1>
+        index = atoi( argv[1] );
+        vexMotorBatteryCompSet( index, atoi( argv[2] ) ? TRUE : FALSE );
+        vex_chprintf(chp, "motor %d battery compensation %s\r\n", index, vexMotorBatteryCompGet( index ) ? "on" : "off" );
         }
     else
         {
@@ -387,13 +1281,15 @@ vexMotorDebug(vexStream *chp, int argc, char *argv[])
 /*-----------------------------------------------------------------------------*/
 
 #ifdef  BOARD_OLIMEX_STM32_P103
-CH_IRQ_HANDLER(TIM3_IRQHandler) {
+VEX_RAMTEXT CH_IRQ_HANDLER(TIM3_IRQHandler) {
 #else
-CH_IRQ_HANDLER(TIM4_IRQHandler) {
+VEX_RAMTEXT CH_IRQ_HANDLER(TIM4_IRQHandler) {
 #endif
 
     CH_IRQ_PROLOGUE();
 
+    VEX_ISR_ENTER();
+
     // clear interrupt
     PwmTimer->SR = 0;
 
@@ -401,9 +1297,9 @@ CH_IRQ_HANDLER(TIM4_IRQHandler) {
 
     // check motor 0
     if(!vexMotors[kVexMotor_1].reversed)
-        m0_new_value = vexMotors[kVexMotor_1].value;
+        m0_new_value = vexMotors[kVexMotor_1].output_ext;
     else
-        m0_new_value = -vexMotors[kVexMotor_1].value;
+        m0_new_value = -vexMotors[kVexMotor_1].output_ext;
 
     if( m0_cur_value != m0_new_value )
         {
@@ -440,9 +1336,9 @@ CH_IRQ_HANDLER(TIM4_IRQHandler) {
         }
      // check motor 9
      if(!vexMotors[kVexMotor_10].reversed)
-         m9_new_value = vexMotors[kVexMotor_10].value;
+         m9_new_value = vexMotors[kVexMotor_10].output_ext;
      else
-         m9_new_value = -vexMotors[kVexMotor_10].value;
+         m9_new_value = -vexMotors[kVexMotor_10].output_ext;
      if( m9_cur_value != m9_new_value )
         {
         // new value is 0 then just set
@@ -477,8 +1373,16 @@ CH_IRQ_HANDLER(TIM4_IRQHandler) {
             }
         }
 
+#if VEX_MOTOR_PWM_ON_CHANGE
+    // nothing more to do until the next vexMotorSet
+    if( (m0_cur_value == m0_new_value) && (m9_cur_value == m9_new_value) )
+        PwmTimer->DIER &= ~TIM_DIER_UIE;
+#endif
+
     chSysUnlockFromIsr();
 
+    VEX_ISR_EXIT( kVexIsrMotorPwm );
+
     CH_IRQ_EPILOGUE();
 }
 
@@ -519,9 +1423,9 @@ _vexMotorPwmInit( TIM_TypeDef *tim )
     tim->DIER = 0;      // All IRQs disabled.
     tim->SR   = 0;      // Clear eventual pending IRQs.
 
-    tim->PSC  = 0x1D8;
-    tim->ARR  = 0x7E;   // Interval
+    // prescaler and period from the frequency
     tim->CR2  = 0;
+    vexMotorPwmFreqSet( VEX_MOTOR_PWM_FREQ );
 
     tim->CCMR1 = TIM_CCMR1_OC1PE | TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 |
                  TIM_CCMR1_OC2PE | TIM_CCMR1_OC2M_2 | TIM_CCMR1_OC2M_1;
@@ -555,13 +1459,28 @@ _vexMotorPwmInit( TIM_TypeDef *tim )
     palSetPadMode( VEX_PWM_PORT, VEX_PWM_T9_N_PIN, PAL_MODE_STM32_ALTERNATE_PUSHPULL );
     palSetPadMode( VEX_PWM_PORT, VEX_PWM_T9_P_PIN, PAL_MODE_STM32_ALTERNATE_PUSHPULL );
 
-    // enable ints
+    // enable ints, when only updating on change vexMotorSet does this
     //tim->EGR  = TIM_EGR_UG;
+#if !VEX_MOTOR_PWM_ON_CHANGE
     tim->DIER = TIM_DIER_UIE;
+#endif
     tim->SR   = 0;
 
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @private                                                                   */
+/** @brief      Convert a command to timer counts                              */
+/** @param[in]  x The command (0 to VEX_MOTOR_PWM_MAX)                         */
+/** @returns    The compare value for the current period                      */
+/*-----------------------------------------------------------------------------*/
+
+static uint32_t
+_vexMotorPwmCounts( uint32_t x )
+{
+    return( (x * PwmPeriod) / VEX_MOTOR_PWM_MAX );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @private                                                                   */
 /** @brief      Control motor on port 0                                        */
@@ -574,7 +1493,7 @@ _vexMotorPwmInit( TIM_TypeDef *tim )
 void
 _vexMotorPwmSet_0( int16_t value )
 {
-    int16_t x;
+    uint32_t    x;
 
     if( PwmTimer == NULL )
         return;
@@ -583,7 +1502,8 @@ _vexMotorPwmSet_0( int16_t value )
         {
         PwmTimer->CCR2 = 0;
         palClearPad( VEX_PWM_PORT, VEX_EBL_T0_N_PIN );
-        x = value & 0x7F;
+        x = ( value > VEX_MOTOR_PWM_MAX ) ? VEX_MOTOR_PWM_MAX : value;
+        x = _vexMotorPwmCounts( x );
         palSetPad( VEX_PWM_PORT, VEX_EBL_T0_P_PIN );
         PwmTimer->CCR1 = x;
         }
@@ -592,7 +1512,8 @@ _vexMotorPwmSet_0( int16_t value )
         {
         PwmTimer->CCR1 = 0;
         palClearPad( VEX_PWM_PORT, VEX_EBL_T0_P_PIN );
-        x = (-value) & 0x7F;
+        x = ( -value > VEX_MOTOR_PWM_MAX ) ? VEX_MOTOR_PWM_MAX : -value;
+        x = _vexMotorPwmCounts( x );
         palSetPad( VEX_PWM_PORT, VEX_EBL_T0_N_PIN );
         PwmTimer->CCR2 = x;
         }
@@ -617,7 +1538,7 @@ _vexMotorPwmSet_0( int16_t value )
 void
 _vexMotorPwmSet_9( int16_t value )
 {
-    int16_t x;
+    uint32_t    x;
 
     if( PwmTimer == NULL )
         return;
@@ -626,7 +1547,8 @@ _vexMotorPwmSet_9( int16_t value )
         {
         PwmTimer->CCR4 = 0;
         palClearPad( VEX_PWM_PORT, VEX_EBL_T9_N_PIN );
-        x = value & 0x7F;
+        x = ( value > VEX_MOTOR_PWM_MAX ) ? VEX_MOTOR_PWM_MAX : value;
+        x = _vexMotorPwmCounts( x );
         palSetPad( VEX_PWM_PORT, VEX_EBL_T9_P_PIN );
         PwmTimer->CCR3 = x;
         }
@@ -635,7 +1557,8 @@ _vexMotorPwmSet_9( int16_t value )
         {
         PwmTimer->CCR3 = 0;
         palClearPad( VEX_PWM_PORT, VEX_EBL_T9_P_PIN );
-        x = (-value) & 0x7F;
+        x = ( -value > VEX_MOTOR_PWM_MAX ) ? VEX_MOTOR_PWM_MAX : -value;
+        x = _vexMotorPwmCounts( x );
         palSetPad( VEX_PWM_PORT, VEX_EBL_T9_N_PIN );
         PwmTimer->CCR4 = x;
         }
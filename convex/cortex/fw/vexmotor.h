@@ -127,13 +127,102 @@ typedef enum {
 #define kVexMotorNormal     FALSE       ///< Motor command causes normal movement
 #define kVexMotorReversed   TRUE        ///< Motor command causes reversed movement
 
+#define kVexMotorOptLinearize   0x0001  ///< Linearize output for the motor type
+#define kVexMotorOptBatteryComp 0x0002  ///< Compensate output for battery voltage
+#define kVexMotorOptNoLinearize 0x0004  ///< Do not linearize, overrides the default
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Only enable the pwm timer interrupt when ports 1 or 10 change  */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  When FALSE the timer interrupts every pwm period (about 1200 times a
+ *  second) and checks for new values for motors 1 and 10.
+ */
+#if !defined(VEX_MOTOR_PWM_ON_CHANGE)
+#define VEX_MOTOR_PWM_ON_CHANGE     TRUE
+#endif
+
+/*-----------------------------------------------------------------------------*/
+/** @{                                                                         */
+/** @name Direct H-bridge (ports 1 and 10) pwm                                 */
+/*-----------------------------------------------------------------------------*/
+/** @brief  Full scale for vexMotorSetExt, 12 bit resolution                   */
+#define VEX_MOTOR_PWM_MAX           4095
+/** @brief  Default pwm frequency in Hz, exact with a 60000 count period       */
+#if !defined(VEX_MOTOR_PWM_FREQ)
+#define VEX_MOTOR_PWM_FREQ          1200
+#endif
+/** @brief  Allowed pwm frequency range in Hz                                  */
+#define VEX_MOTOR_PWM_FREQ_MIN      100
+#define VEX_MOTOR_PWM_FREQ_MAX      16000
+/** @} */
+
+/*-----------------------------------------------------------------------------*/
+/** @brief  Linearize output when a motor type is set                          */
+/** @details
+ *  vexMotorTypeSet enables linearization for the type unless this is FALSE,
+ *  vexMotorLinearizeSet or kVexMotorOptNoLinearize turn it off for a motor.
+ */
+#if !defined(VEX_MOTOR_LINEARIZE_DEFAULT)
+#define VEX_MOTOR_LINEARIZE_DEFAULT TRUE
+#endif
+
+/*-----------------------------------------------------------------------------*/
+/** @{                                                                         */
+/** @name Battery compensation                                                 */
+/*-----------------------------------------------------------------------------*/
+/** @brief  Battery voltage in mV where compensated output equals the command  */
+#if !defined(VEX_MOTOR_BATTERY_NOMINAL)
+#define VEX_MOTOR_BATTERY_NOMINAL   7200
+#endif
+/** @brief  No compensation below this voltage in mV, battery not connected    */
+#define VEX_MOTOR_BATTERY_MIN       4000
+/** @brief  Battery filter, each tick moves 1/(2^n) of the way to the reading  */
+#if !defined(VEX_MOTOR_BATTERY_FILTER)
+#define VEX_MOTOR_BATTERY_FILTER    4
+#endif
+/** @} */
+
+/*-----------------------------------------------------------------------------*/
+/** @{                                                                         */
+/** @name Motor command mailbox                                                */
+/*-----------------------------------------------------------------------------*/
+/** @brief  Number of command priorities (slots) for each motor                */
+#if !defined(VEX_MOTOR_CMD_PRIORITIES)
+#define VEX_MOTOR_CMD_PRIORITIES    4
+#endif
+/** @brief  Default max age of a command in mS, 0 means never stale           */
+#if !defined(VEX_MOTOR_CMD_MAX_AGE)
+#define VEX_MOTOR_CMD_MAX_AGE       100
+#endif
+/** @brief  Amount a motor without a fresh command moves towards 0 each tick   */
+#if !defined(VEX_MOTOR_CMD_DECAY)
+#define VEX_MOTOR_CMD_DECAY         16
+#endif
+/** @} */
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Holds one command slot for a motor                             */
+/*-----------------------------------------------------------------------------*/
+typedef struct _vexMotorCmd {
+    Thread * volatile   owner;          ///< thread that wrote the command
+    volatile systime_t  time;           ///< when the command was written
+    volatile int16_t    value;          ///< the command (-127 to 127)
+    } vexMotorCmd;
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Holds data for a motor                                         */
 /*-----------------------------------------------------------------------------*/
 typedef struct _vexMotor {
     volatile int16_t    value;
+    volatile int16_t    value_ext;      ///< ports 1 and 10 at VEX_MOTOR_PWM_MAX scale
+    volatile int16_t    output;         ///< value after linearization
+    volatile int16_t    output_ext;     ///< value_ext after linearization
     tVexMotorType       type;
     bool_t              reversed;
+    bool_t              linearize;      ///< use the response lut for the type
+    bool_t              battcomp;       ///< compensate for battery voltage
+    bool_t              saturated;      ///< compensated output was limited
     int32_t            (*motorPositionGet)( int16_t port );
     void               (*motorPositionSet)( int16_t port, int32_t value );
     int16_t            (*getEncoderId)( int16_t port );
@@ -146,6 +235,20 @@ void            vexMotorInit(void);
 void            vexMotorSet( int16_t index, int16_t value );
 int16_t         vexMotorGet( int16_t index );
 void            vexMotorStopAll(void);
+void            vexMotorSetExt( int16_t index, int16_t value );
+int16_t         vexMotorGetExt( int16_t index );
+int16_t         vexMotorOutputGet( int16_t index );
+int16_t         vexMotorOutputGetExt( int16_t index );
+void            vexMotorLinearizeSet( int16_t index, bool_t enable );
+bool_t          vexMotorLinearizeGet( int16_t index );
+void            vexMotorBatteryCompSet( int16_t index, bool_t enable );
+bool_t          vexMotorBatteryCompGet( int16_t index );
+bool_t          vexMotorSaturatedGet( int16_t index );
+void            vexMotorBatteryNominalSet( uint16_t mv );
+uint16_t        vexMotorBatteryGet(void);
+void            vexMotorBatteryUpdate(void);
+uint32_t        vexMotorPwmFreqSet( uint32_t freq );
+uint32_t        vexMotorPwmFreqGet( int16_t index );
 
 void            vexMotorTypeSet( int16_t index, tVexMotorType type );
 tVexMotorType   vexMotorTypeGet( int16_t index );
@@ -159,6 +262,13 @@ void            vexMotorPositionSetCallback( int16_t index, void    (*cb)(int16_
 void            vexMotorEncoderIdCallback( int16_t index, int16_t (*cb)(int16_t), int16_t port );
 int16_t         vexMotorEncoderIdGet( int16_t index );
 
+bool_t          vexMotorCommandSet( int16_t index, int16_t value, int16_t priority );
+void            vexMotorCommandRelease( int16_t index, int16_t priority );
+void            vexMotorCommandMaxAgeSet( int16_t index, uint16_t ms );
+void            vexMotorCommandUpdate(void);
+void            vexMotorCommandDebug(vexStream *chp, int argc, char *argv[]);
+void            vexMotorThreadExit( void *tp );
+
 // do not call these
 /** @private                                                                   */
 void            _vexMotorPwmInit( TIM_TypeDef *tim );
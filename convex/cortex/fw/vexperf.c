@@ -0,0 +1,404 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexperf.c                                                    */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Lightweight profiling using the DWT cycle counter.                      */
+/*                                                                             */
+/*    The kernel context switch hook charges elapsed cycles to the thread     */
+/*    being switched out, the count is kept in the thread structure           */
+/*    (THREAD_EXT_FIELDS in chconf.h) so the hook is a few instructions.      */
+/*    Time spent in interrupt handlers is charged to the interrupted thread.  */
+/*                                                                             */
+/*    Periodic tasks can also call vexPerfPeriodicStart and End each          */
+/*    iteration to record latency, jitter, execution time and deadline       */
+/*    misses.                                                                 */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexperf.c
+  * @brief   Thread cpu usage and periodic task timing
+*//*---------------------------------------------------------------------------*/
+
+/** @cond */
+#define _PerfCyclesToUs( x )    ((x) / (halGetCounterFrequency() / 1000000))
+#define _PerfUsToCycles( x )    ((x) * (halGetCounterFrequency() / 1000000))
+/** @endcond */
+
+// cycle count at the last context switch
+static  uint32_t         vexPerfSwitchCycles = 0;
+// cycle count at the last system tick
+static  uint32_t         vexPerfTickCycles = 0;
+
+// the periodic tasks being monitored
+static  vexPerfPeriodic *vexPerfPeriodics[VEX_PERF_MAX_PERIODIC];
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called by the kernel on every context switch                   */
+/** @param[in]  ntp thread being switched in                                   */
+/** @param[in]  otp thread being switched out                                  */
+/*-----------------------------------------------------------------------------*/
+/** @note       Called with the kernel locked                                  */
+
+void
+vexPerfContextSwitch( void *ntp, void *otp )
+{
+    uint32_t    now = halGetCounterValue();
+
+    (void)ntp;
+
+    ((Thread *)otp)->p_cycles += now - vexPerfSwitchCycles;
+    vexPerfSwitchCycles = now;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called by the kernel on every system tick                      */
+/*-----------------------------------------------------------------------------*/
+/** @note       Called from the tick ISR with the kernel locked                */
+
+void
+vexPerfSystemTick()
+{
+    vexPerfTickCycles = halGetCounterValue();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize and register a periodic task monitor               */
+/** @param[in]  p pointer to storage for the monitor                           */
+/** @param[in]  name name shown by vexPerfDebug                                */
+/** @param[in]  period_us the expected time between iterations in uS          */
+/** @param[in]  deadline_us the allowed time for each iteration, 0 for period  */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexPerfPeriodicInit( vexPerfPeriodic *p, char *name, uint32_t period_us, uint32_t deadline_us )
+{
+    int16_t     i;
+
+    if( p == NULL )
+        return;
+
+    memset( p, 0, sizeof( vexPerfPeriodic ) );
+
+    p->name     = name;
+    p->period   = _PerfUsToCycles( period_us );
+    p->deadline = _PerfUsToCycles( deadline_us ? deadline_us : period_us );
+
+    chSysLock();
+    for(i=0;i<VEX_PERF_MAX_PERIODIC;i++)
+        {
+        if( vexPerfPeriodics[i] == p )
+            break;
+        if( vexPerfPeriodics[i] == NULL )
+            {
+            vexPerfPeriodics[i] = p;
+            break;
+            }
+        }
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Mark the start of an iteration                                 */
+/** @param[in]  p pointer to the monitor                                       */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexPerfPeriodicStart( vexPerfPeriodic *p )
+{
+    uint32_t    now = halGetCounterValue();
+    uint32_t    latency;
+    int32_t     jitter;
+
+    if( p == NULL )
+        return;
+
+    latency = now - vexPerfTickCycles;
+    if( latency > p->latency_max )
+        p->latency_max = latency;
+
+    if( p->count > 0 )
+        {
+        jitter = (int32_t)(now - p->start - p->period);
+        if( (uint32_t)abs(jitter) > p->jitter_max )
+            p->jitter_max = abs(jitter);
+        }
+
+    p->start = now;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Mark the end of an iteration                                   */
+/** @param[in]  p pointer to the monitor                                       */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexPerfPeriodicEnd( vexPerfPeriodic *p )
+{
+    uint32_t    exec;
+
+    if( p == NULL )
+        return;
+
+    exec = halGetCounterValue() - p->start;
+
+    p->exec_last = exec;
+    if( exec > p->exec_max )
+        p->exec_max = exec;
+
+    if( p->count++ == 0 )
+        p->exec_avg = exec;
+    else
+        p->exec_avg += ((int32_t)(exec - p->exec_avg)) >> 4;
+
+    if( exec > p->deadline )
+        p->missed++;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Clear the statistics for all periodic tasks                    */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexPerfReset()
+{
+    int16_t     i;
+    vexPerfPeriodic *p;
+
+    for(i=0;i<VEX_PERF_MAX_PERIODIC;i++)
+        {
+        if( (p = vexPerfPeriodics[i]) == NULL )
+            continue;
+
+        chSysLock();
+        p->count       = 0;
+        p->missed      = 0;
+        p->exec_max    = 0;
+        p->latency_max = 0;
+        p->jitter_max  = 0;
+        chSysUnlock();
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get cycles used by a thread including the current time slice   */
+/*-----------------------------------------------------------------------------*/
+
+static uint32_t
+_vexPerfThreadCycles( Thread *tp )
+{
+    uint32_t    cycles;
+
+    chSysLock();
+    cycles = tp->p_cycles;
+    if( tp == chThdSelf() )
+        cycles += halGetCounterValue() - vexPerfSwitchCycles;
+    chSysUnlock();
+
+    return( cycles );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Sample cycles used by all threads                              */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A reference is added to each thread sampled so that a dynamic thread
+ *  exiting before _vexPerfRelease is called is not freed.
+ */
+
+static int16_t
+_vexPerfSample( Thread **tps, uint32_t *cycles )
+{
+    Thread      *tp;
+    int16_t     n = 0;
+
+    // the registry only holds a reference on the thread being visited
+    tp = chRegFirstThread();
+    while( tp != NULL && n < VEX_PERF_MAX_THREADS )
+        {
+        tps[n]    = chThdAddRef( tp );
+        cycles[n] = _vexPerfThreadCycles( tp );
+        n++;
+        tp = chRegNextThread(tp);
+        }
+
+    // release the reference if we stopped early
+    if( tp != NULL )
+        chThdRelease(tp);
+
+    return(n);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Release the references taken by _vexPerfSample                 */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_vexPerfRelease( Thread **tps, int16_t n )
+{
+    int16_t     i;
+
+    for(i=0;i<n;i++)
+        chThdRelease( tps[i] );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show thread cpu usage and periodic task timing                 */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  perf [ms]        - cpu usage over ms (default 1000) and task timing
+ *  perf reset       - clear the task timing statistics
+ *  perf log [ms]    - one line of comma separated values every ms until a key
+ *                     is pressed, for logging on a PC
+ */
+
+void
+vexPerfDebug(vexStream *chp, int argc, char *argv[])
+{
+    static  Thread      *tps[VEX_PERF_MAX_THREADS];
+    static  uint32_t    c0[VEX_PERF_MAX_THREADS];
+    static  uint32_t    c1[VEX_PERF_MAX_THREADS];
+            int16_t     n0, i, j;
+            uint32_t    t0, total, used;
+            int32_t     window = 1000;
+            bool_t      log = FALSE;
+            vexPerfPeriodic *p;
+
+    if( argc > 0 && strcmp( argv[0], "reset" ) == 0 )
+        {
+        vexPerfReset();
+        return;
+        }
+    if( argc > 0 && strcmp( argv[0], "log" ) == 0 )
+        {
+        log = TRUE;
+        argc--;
+        argv++;
+        }
+    if( argc > 0 )
+        window = atoi( argv[0] );
+
+    // cycle counter wraps after about 60 seconds
+    if( window < 100 )   window = 100;
+    if( window > 10000 ) window = 10000;
+
+    if( log )
+        {
+        vex_chprintf(chp, "time,load");
+        for(i=0;i<VEX_PERF_MAX_PERIODIC;i++)
+            if( (p = vexPerfPeriodics[i]) != NULL )
+                vex_chprintf(chp, ",%s_exec,%s_max,%s_lat,%s_missed", p->name, p->name, p->name, p->name );
+        vex_chprintf(chp, "\r\n");
+        }
+
+    do
+        {
+        // cpu use over the window
+        t0 = halGetCounterValue();
+        n0 = _vexPerfSample( tps, c0 );
+        chThdSleepMilliseconds( window );
+        total = halGetCounterValue() - t0;
+        for(i=0;i<n0;i++)
+            c1[i] = _vexPerfThreadCycles( tps[i] );
+
+        // anything that is not idle is load
+        used = 0;
+        for(i=0;i<n0;i++)
+            {
+            if( tps[i]->p_prio != IDLEPRIO )
+                used += c1[i] - c0[i];
+            }
+
+        if( log )
+            {
+            vex_chprintf(chp, "%d,%d", chTimeNow(), (int)(((uint64_t)used * 1000) / total) );
+            for(i=0;i<VEX_PERF_MAX_PERIODIC;i++)
+                {
+                if( (p = vexPerfPeriodics[i]) == NULL )
+                    continue;
+                vex_chprintf(chp, ",%d,%d,%d,%d", _PerfCyclesToUs(p->exec_last), _PerfCyclesToUs(p->exec_max),
+                                              _PerfCyclesToUs(p->latency_max), p->missed );
+                }
+            vex_chprintf(chp, "\r\n");
+            _vexPerfRelease( tps, n0 );
+            continue;
+            }
+
+        vex_chprintf(chp, "            name  prio   cpu%%      uS\r\n");
+        for(i=0;i<n0;i++)
+            {
+            used = c1[i] - c0[i];
+            if( tps[i]->p_name != NULL )
+                vex_chprintf(chp, "%16s ", tps[i]->p_name);
+            else
+                vex_chprintf(chp, "%16.8X ", tps[i]);
+            j = (int16_t)(((uint64_t)used * 1000) / total);
+            vex_chprintf(chp, "%5d %3d.%d %8d\r\n", tps[i]->p_prio, j / 10, j % 10, _PerfCyclesToUs(used) );
+            }
+        _vexPerfRelease( tps, n0 );
+
+        vex_chprintf(chp, "\r\n            name  period     count  missed   exec   max    late  jitter  headroom\r\n");
+        for(i=0;i<VEX_PERF_MAX_PERIODIC;i++)
+            {
+            if( (p = vexPerfPeriodics[i]) == NULL )
+                continue;
+            vex_chprintf(chp, "%16s %7d %9d %7d %6d %5d %7d %7d %9d\r\n", p->name,
+                _PerfCyclesToUs(p->period), p->count, p->missed,
+                _PerfCyclesToUs(p->exec_avg), _PerfCyclesToUs(p->exec_max),
+                _PerfCyclesToUs(p->latency_max), _PerfCyclesToUs(p->jitter_max),
+                (int32_t)_PerfCyclesToUs(p->period) - (int32_t)_PerfCyclesToUs(p->exec_max) );
+            }
+        vex_chprintf(chp, "times in uS\r\n");
+        } while( log && sdGetWouldBlock((SerialDriver *)chp) );
+}
@@ -0,0 +1,105 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexperf.h                                                    */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __VEXPERF__
+#define __VEXPERF__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexperf.h
+  * @brief   Thread cpu usage and periodic task timing, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Maximum number of periodic tasks that can be monitored         */
+/*-----------------------------------------------------------------------------*/
+#define VEX_PERF_MAX_PERIODIC       8
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Maximum number of threads shown by vexPerfDebug                */
+/*-----------------------------------------------------------------------------*/
+#define VEX_PERF_MAX_THREADS        24
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Timing for one periodic task                                   */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  All times are in cycles of the DWT cycle counter.  Latency is from the
+ *  system tick to the start of the iteration, jitter is the largest
+ *  difference between the time from one start to the next and the period.
+ */
+typedef struct _vexPerfPeriodic {
+    char        *name;
+    uint32_t    period;         ///< expected time between starts
+    uint32_t    deadline;       ///< allowed time from start to end
+
+    uint32_t    start;          ///< cycle count at the last start
+    uint32_t    count;          ///< number of iterations
+    uint32_t    missed;         ///< iterations that took longer than deadline
+
+    uint32_t    exec_last;      ///< last start to end time
+    uint32_t    exec_avg;       ///< filtered start to end time
+    uint32_t    exec_max;
+    uint32_t    latency_max;
+    uint32_t    jitter_max;
+    } vexPerfPeriodic;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        vexPerfContextSwitch( void *ntp, void *otp );
+void        vexPerfSystemTick( void );
+
+void        vexPerfPeriodicInit( vexPerfPeriodic *p, char *name, uint32_t period_us, uint32_t deadline_us );
+void        vexPerfPeriodicStart( vexPerfPeriodic *p );
+void        vexPerfPeriodicEnd( vexPerfPeriodic *p );
+void        vexPerfReset( void );
+void        vexPerfDebug(vexStream *chp, int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __VEXPERF__
@@ -0,0 +1,30 @@
+# Run time critical code from RAM, set USE_VEX_RAMTEXT = yes in the project
+# Makefile.  Functions are selected with VEX_RAMTEXT in the source and linked
+# into .ramtext, which the linker script copies to RAM with the data section.
+#
+# Run "make ramtextreport" after building to list RAM resident code from the
+# map file.  To compare timing build with and without the option and use the
+# "isr" (needs VEX_ISR_PROFILE_ENABLE) and "perf" shell commands.
+
+ifeq ($(USE_VEX_RAMTEXT),yes)
+  UDEFS += -DVEX_RAMTEXT_ENABLE
+endif
+
+NM ?= $(TRGT)nm
+
+.PHONY: ramtextreport
+ramtextreport: $(BUILDDIR)/$(PROJECT).elf
+	@$(NM) -S -t d --size-sort $< | awk \
+	  'function hex(s,  i, n) { n = 0; s = tolower(s); sub(/^0x/, "", s); \
+	       for(i = 1; i <= length(s); i++) n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1; \
+	       return n } \
+	   BEGIN { print "ramtext by object"; total = 0; lo = -1; hi = 0 } \
+	   NR == FNR { if( $$1 == ".ramtext" && NF == 4 ) { \
+	                   a = hex($$2); n = hex($$3); total += n; \
+	                   printf "  %6d  %s\n", n, $$4; \
+	                   if( lo < 0 || a < lo ) lo = a; if( a + n > hi ) hi = a + n } \
+	               next } \
+	   FNR == 1 { printf "  %6d  total bytes\nramtext functions\n", total; shown = 1 } \
+	   NF == 4 && $$1 >= lo && $$1 < hi { printf "  %6d  %s\n", $$2, $$4 } \
+	   END { if( !shown ) printf "  %6d  total bytes\n", total }' \
+	  $(BUILDDIR)/$(PROJECT).map -
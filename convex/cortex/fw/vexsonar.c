@@ -203,6 +203,8 @@ _vs_echo_cb(EXTDriver *extp, expchannel_t channel)
     (void)extp;
     (void)channel;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     if( palReadPad( vexSonars[nextSonar].pb_port,  vexSonars[nextSonar].pb_pad ) )
@@ -214,6 +216,8 @@ _vs_echo_cb(EXTDriver *extp, expchannel_t channel)
         }
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrSonar );
 }
 
 /*-----------------------------------------------------------------------------*/
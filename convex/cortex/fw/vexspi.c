@@ -97,11 +97,13 @@ static const unsigned char txInitData[32] =
 /*  rather than spinning in a loop                                             */
 /*-----------------------------------------------------------------------------*/
 
-static void
+static VEX_RAMTEXT void
 _vspi_gpt_cb(GPTDriver *gptp)
 {
     (void)gptp;
 
+    VEX_ISR_ENTER();
+
     chSysLockFromIsr();
 
     // wake thread
@@ -111,6 +113,8 @@ _vspi_gpt_cb(GPTDriver *gptp)
       }
 
     chSysUnlockFromIsr();
+
+    VEX_ISR_EXIT( kVexIsrSpiTimer );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -318,7 +322,7 @@ vexSpiTickDelay(int16_t tick)
  *  original code.
  */
 
-void
+VEX_RAMTEXT void
 vexSpiSend()
 {
     int16_t      i;
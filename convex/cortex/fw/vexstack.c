@@ -0,0 +1,258 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexstack.c                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Stack high water marks.  With CH_DBG_FILL_THREADS the kernel fills      */
+/*    each new stack with CH_STACK_FILL_VALUE, a low priority thread then      */
+/*    scans every stack once a second for the deepest byte that has been      */
+/*    written.  The stack size is found when the thread is created, the       */
+/*    initial context sits at the top of the working area.                    */
+/*                                                                             */
+/*    Peaks are remembered by thread name so tasks that have exited, such as  */
+/*    ROBOTC style tasks started from the heap, are still reported.           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexstack.c
+  * @brief   Thread stack usage
+*//*---------------------------------------------------------------------------*/
+
+static  vexStackRecord  vexStackRecords[VEX_STACK_MAX_RECORDS];
+static  int16_t         vexStackRecordNum = 0;
+
+static WORKING_AREA(waVexStackTask, VEX_STACK_TASK_STACK_SIZE);
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Called by the kernel when a thread is created                  */
+/** @param[in]  tp pointer to the new thread                                   */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Runs from THREAD_EXT_INIT_HOOK after the initial context has been set up.
+ *  The main thread runs on the process stack and has no context yet so its
+ *  size is left as 0 and it is not scanned.
+ */
+
+void
+vexStackThreadInit( void *tp )
+{
+    Thread  *t = (Thread *)tp;
+
+    if( t->p_ctx.r13 == NULL )
+        t->p_stksize = 0;
+    else
+        t->p_stksize = ((uint8_t *)t->p_ctx.r13 + sizeof(struct intctx)) - (uint8_t *)(t + 1);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Find the number of bytes of stack a thread has used            */
+/*-----------------------------------------------------------------------------*/
+
+static uint16_t
+_vexStackUsed( Thread *tp )
+{
+    uint8_t     *p   = (uint8_t *)(tp + 1);
+    uint8_t     *end = p + tp->p_stksize;
+
+    // the stack grows down so unused bytes are at the bottom
+    while( p < end && *p == CH_STACK_FILL_VALUE )
+        p++;
+
+    return( end - p );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Find or add the record for a thread                            */
+/*-----------------------------------------------------------------------------*/
+
+static vexStackRecord *
+_vexStackRecordGet( Thread *tp )
+{
+    int16_t     i;
+    const char  *name = (tp->p_name != NULL) ? tp->p_name : "unnamed";
+
+    for(i=0;i<vexStackRecordNum;i++)
+        {
+        if( vexStackRecords[i].size == tp->p_stksize && strcmp( vexStackRecords[i].name, name ) == 0 )
+            return( &vexStackRecords[i] );
+        }
+
+    if( vexStackRecordNum == VEX_STACK_MAX_RECORDS )
+        return( NULL );
+
+    vexStackRecords[vexStackRecordNum].name = name;
+    vexStackRecords[vexStackRecordNum].size = tp->p_stksize;
+    vexStackRecords[vexStackRecordNum].peak = 0;
+
+    return( &vexStackRecords[vexStackRecordNum++] );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Scan all thread stacks and update the peak use                 */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexStackScan()
+{
+    Thread          *tp;
+    vexStackRecord  *r;
+    uint16_t        used;
+
+    tp = chRegFirstThread();
+    while( tp != NULL )
+        {
+        if( tp->p_stksize > 0 )
+            {
+            used = _vexStackUsed( tp );
+
+            chSysLock();
+            r = _vexStackRecordGet( tp );
+            if( r != NULL && used > r->peak )
+                r->peak = used;
+            chSysUnlock();
+            }
+
+        tp = chRegNextThread(tp);
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Number of threads with less than VEX_STACK_LOW_BYTES left      */
+/** @returns    the count                                                      */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+vexStackLowCount()
+{
+    int16_t     i, n = 0;
+
+    for(i=0;i<vexStackRecordNum;i++)
+        {
+        if( (vexStackRecords[i].size - vexStackRecords[i].peak) < VEX_STACK_LOW_BYTES )
+            n++;
+        }
+
+    return(n);
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Stack scan thread                                                          */
+/*-----------------------------------------------------------------------------*/
+
+static msg_t
+vexStackTask( void *arg )
+{
+    (void)arg;
+
+    chRegSetThreadName("stack");
+
+    while(!chThdShouldTerminate())
+        {
+        vexStackScan();
+        chThdSleepMilliseconds(VEX_STACK_SCAN_MS);
+        }
+
+    return (msg_t)0;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start the stack scan thread                                    */
+/*-----------------------------------------------------------------------------*/
+
+void
+vexStackInit()
+{
+    chThdCreateStatic(waVexStackTask, sizeof(waVexStackTask), VEX_STACK_THREAD_PRIORITY, vexStackTask, NULL);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show peak stack use                                            */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  stack           - table of size, peak use and free bytes
+ *  stack json      - the same as JSON, to compare with the build report made
+ *                    by "make stackreport"
+ */
+
+void
+vexStackDebug(vexStream *chp, int argc, char *argv[])
+{
+    int16_t         i;
+    vexStackRecord  r;
+    bool_t          json = (argc > 0 && strcmp( argv[0], "json" ) == 0);
+
+    vexStackScan();
+
+    if( json )
+        vex_chprintf(chp, "{\r\n  \"threads\": [");
+    else
+        vex_chprintf(chp, "            name  size  peak  free  use%%\r\n");
+
+    for(i=0;i<vexStackRecordNum;i++)
+        {
+        chSysLock();
+        r = vexStackRecords[i];
+        chSysUnlock();
+
+        if( json )
+            vex_chprintf(chp, "%s\r\n    { \"name\": \"%s\", \"size\": %d, \"peak\": %d }",
+                (i > 0) ? "," : "", r.name, r.size, r.peak );
+        else
+            vex_chprintf(chp, "%16s %5d %5d %5d %4d%s\r\n", r.name, r.size, r.peak,
+                r.size - r.peak, (r.peak * 100) / r.size,
+                (r.size - r.peak) < VEX_STACK_LOW_BYTES ? " LOW" : "" );
+        }
+
+    if( json )
+        vex_chprintf(chp, "\r\n  ]\r\n}\r\n");
+}
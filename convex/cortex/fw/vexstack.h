@@ -0,0 +1,94 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     vexstack.h                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __VEXSTACK__
+#define __VEXSTACK__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    vexstack.h
+  * @brief   Thread stack usage, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stack scan thread                                              */
+/*-----------------------------------------------------------------------------*/
+#define VEX_STACK_SCAN_MS           1000
+#define VEX_STACK_THREAD_PRIORITY   (LOWPRIO + 1)
+#define VEX_STACK_TASK_STACK_SIZE   0x80
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Number of threads remembered, including those that have exited */
+/*-----------------------------------------------------------------------------*/
+#define VEX_STACK_MAX_RECORDS       24
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Free stack below this is flagged as low                        */
+/*-----------------------------------------------------------------------------*/
+#define VEX_STACK_LOW_BYTES         64
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Peak stack use for one thread                                  */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    const char  *name;
+    uint16_t    size;           ///< stack size in bytes
+    uint16_t    peak;           ///< most bytes ever used
+    } vexStackRecord;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        vexStackThreadInit( void *tp );
+void        vexStackInit( void );
+void        vexStackScan( void );
+int16_t     vexStackLowCount( void );
+void        vexStackDebug(vexStream *chp, int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __VEXSTACK__
@@ -0,0 +1,16 @@
+# Stack report, run "make stackreport" after building.
+# Writes the size of every thread working area (symbols starting "wa") to
+# $(BUILDDIR)/$(PROJECT)_stack.json, compare this with the peak use shown by
+# the "stack json" shell command to see which stacks can be made smaller.
+# Threads started from the heap, for example ROBOTC style tasks, are not
+# listed as they have no symbol.
+
+NM ?= $(TRGT)nm
+
+.PHONY: stackreport
+stackreport: $(BUILDDIR)/$(PROJECT).elf
+	@$(NM) -S -t d $< | awk \
+	  'BEGIN { printf "{\n  \"project\": \"$(PROJECT)\",\n  \"working_areas\": ["; n = 0 } \
+	   NF == 4 && $$4 ~ /^wa/ { printf "%s\n    { \"name\": \"%s\", \"size\": %d }", (n++ ? "," : ""), $$4, $$2 } \
+	   END { printf "\n  ]\n}\n" }' > $(BUILDDIR)/$(PROJECT)_stack.json
+	@echo Stack report in $(BUILDDIR)/$(PROJECT)_stack.json
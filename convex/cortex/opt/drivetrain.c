@@ -0,0 +1,327 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     drivetrain.c                                                 */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Converts tank, arcade or holonomic (forward, strafe, turn) commands      */
+/*    into wheel commands.  Integer only, when any wheel would exceed full     */
+/*    scale all wheels are scaled down together so the direction of travel     */
+/*    is kept.                                                                 */
+/*                                                                             */
+/*    Field centric control rotates the forward and strafe commands by the     */
+/*    gyro heading using the fixed point sine from the odometry module,        */
+/*    forward on the joystick is then always away from the driver.             */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+#include "smartmotor.h"
+#include "vexgyro.h"
+#include "odometry.h"
+#include "drivetrain.h"
+
+/*-----------------------------------------------------------------------------*/
+/** @file    drivetrain.c
+  * @brief   Drivetrain kinematics
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/*  All drivetrain data                                                        */
+/*-----------------------------------------------------------------------------*/
+typedef struct _driveSystem {
+    tDriveType   type;
+    tVexMotor    motors[ kDriveWheelNum ][ DRIVE_WHEEL_MOTORS ];
+    bool_t       smart;          ///< set motors through the smart motor library
+    bool_t       field_centric;  ///< rotate commands by the gyro heading
+    bool_t       gyro_reverse;   ///< gyro counts clockwise
+    int32_t      gyro_offset;    ///< gyro reading for field forward
+    int16_t      wheel[ kDriveWheelNum ];  ///< last wheel commands
+    } driveSystem;
+
+static  driveSystem drive;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize the drivetrain                                      */
+/** @param[in]  type kDriveTank, kDriveMecanum or kDriveXDrive                 */
+/** @param[in]  smart TRUE to set motors using the smart motor library         */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  If smart is TRUE call after SmartMotorsInit.
+ */
+
+void
+DriveInit( tDriveType type, bool_t smart )
+{
+    int16_t i, j;
+
+    drive.type          = type;
+    drive.smart         = smart;
+    drive.field_centric = FALSE;
+    drive.gyro_reverse  = FALSE;
+    drive.gyro_offset   = 0;
+
+    for(i=0;i<kDriveWheelNum;i++)
+        {
+        for(j=0;j<DRIVE_WHEEL_MOTORS;j++)
+            drive.motors[i][j] = kVexMotor_None;
+        drive.wheel[i] = 0;
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Add a motor to a wheel                                         */
+/** @param[in]  wheel the wheel, kDriveLeft or kDriveRight for a tank drive    */
+/** @param[in]  m the motor                                                    */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  When using the smart motor library a second or third motor on the same
+ *  wheel is linked to the first so it shares its encoder.
+ */
+
+void
+DriveMotorAdd( tDriveWheel wheel, tVexMotor m )
+{
+    int16_t j;
+
+    if( wheel < kDriveLeftFront || wheel >= kDriveWheelNum )
+        return;
+    if( m < kVexMotor_1 || m >= kVexMotorNum )
+        return;
+
+    for(j=0;j<DRIVE_WHEEL_MOTORS;j++)
+        {
+        if( drive.motors[wheel][j] == m )
+            return;
+        if( drive.motors[wheel][j] == kVexMotor_None )
+            {
+            if( drive.smart && j > 0 )
+                SmartMotorLinkMotors( drive.motors[wheel][0], m );
+            drive.motors[wheel][j] = m;
+            return;
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Enable field centric control for holonomic drives              */
+/** @param[in]  enable TRUE to use the gyro started with vexGyroInit           */
+/** @param[in]  reversed TRUE if the gyro reading increases clockwise          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The present heading becomes field forward.
+ */
+
+void
+DriveFieldCentricSet( bool_t enable, bool_t reversed )
+{
+    drive.gyro_reverse  = reversed;
+    drive.gyro_offset   = vexGyroGet();
+    drive.field_centric = enable;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Make the present heading field forward                         */
+/*-----------------------------------------------------------------------------*/
+
+void
+DriveHeadingReset()
+{
+    drive.gyro_offset = vexGyroGet();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Limit a command to full scale                                  */
+/*-----------------------------------------------------------------------------*/
+
+static int32_t
+_DriveClip( int32_t value )
+{
+    if( value > 127 )
+        return( 127 );
+    if( value < -127 )
+        return( -127 );
+
+    return( value );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Scale wheel commands and send to the motors                    */
+/** @param[in]  w the wheel commands, may be over full scale                   */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  All wheels are scaled by the same amount so the largest is at full
+ *  scale, clipping each wheel on its own would change the direction.
+ */
+
+static void
+_DriveOutput( int32_t w[ kDriveWheelNum ] )
+{
+    int32_t max = 127;
+    int16_t i, j;
+    tVexMotor m;
+
+    for(i=0;i<kDriveWheelNum;i++)
+        {
+        if( abs(w[i]) > max )
+            max = abs(w[i]);
+        }
+
+    for(i=0;i<kDriveWheelNum;i++)
+        {
+        // rounded to nearest
+        if( max > 127 )
+            w[i] = ((w[i] * 127) + ((w[i] < 0) ? -(max/2) : (max/2))) / max;
+
+        drive.wheel[i] = w[i];
+
+        for(j=0;j<DRIVE_WHEEL_MOTORS;j++)
+            {
+            if( (m = drive.motors[i][j]) == kVexMotor_None )
+                continue;
+
+            if( drive.smart )
+                SetMotor( m, w[i] );
+            else
+                vexMotorSet( m, w[i] );
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Tank control                                                   */
+/** @param[in]  left the left side command                                     */
+/** @param[in]  right the right side command                                   */
+/*-----------------------------------------------------------------------------*/
+
+void
+DriveTank( int16_t left, int16_t right )
+{
+    int32_t w[ kDriveWheelNum ];
+
+    w[kDriveLeftFront]  = w[kDriveLeftBack]  = _DriveClip( left );
+    w[kDriveRightFront] = w[kDriveRightBack] = _DriveClip( right );
+
+    _DriveOutput( w );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Arcade control                                                 */
+/** @param[in]  forward the forward command                                    */
+/** @param[in]  turn the turn command, positive turns right                    */
+/*-----------------------------------------------------------------------------*/
+
+void
+DriveArcade( int16_t forward, int16_t turn )
+{
+    DriveHolonomic( forward, 0, turn );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Holonomic control                                              */
+/** @param[in]  forward the forward command                                    */
+/** @param[in]  right the strafe command, positive moves right                 */
+/** @param[in]  turn the turn command, positive turns right                    */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A tank drive ignores strafe.  With field centric control forward and
+ *  right are relative to the field rather than the robot.
+ */
+
+void
+DriveHolonomic( int16_t forward, int16_t right, int16_t turn )
+{
+    int32_t w[ kDriveWheelNum ];
+    int32_t f, r, t;
+    int32_t g;
+    int32_t s, c;
+    uint16_t heading;
+
+    f = _DriveClip( forward );
+    r = _DriveClip( right );
+    t = _DriveClip( turn );
+
+    if( drive.type == kDriveTank )
+        {
+        w[kDriveLeftFront]  = w[kDriveLeftBack]  = f + t;
+        w[kDriveRightFront] = w[kDriveRightBack] = f - t;
+        _DriveOutput( w );
+        return;
+        }
+
+    if( drive.field_centric )
+        {
+        // counter clockwise heading, 65536 per revolution
+        g = (vexGyroGet() - drive.gyro_offset) % 3600;
+        if( drive.gyro_reverse )
+            g = -g;
+        heading = (uint16_t)((g * 65536) / 3600);
+
+        // rotate by -heading, Q15 sine and cosine
+        s = OdometrySin( heading );
+        c = OdometryCos( heading );
+        g = ((r * c) + (f * s)) >> 15;
+        f = ((f * c) - (r * s)) >> 15;
+        r = g;
+        }
+
+    w[kDriveLeftFront]  = f + r + t;
+    w[kDriveLeftBack]   = f - r + t;
+    w[kDriveRightFront] = f - r - t;
+    w[kDriveRightBack]  = f + r - t;
+
+    _DriveOutput( w );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop all drive motors                                          */
+/*-----------------------------------------------------------------------------*/
+
+void
+DriveStop()
+{
+    DriveTank( 0, 0 );
+}
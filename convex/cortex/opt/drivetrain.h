@@ -0,0 +1,103 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     drivetrain.h                                                 */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __DRIVETRAIN__
+#define __DRIVETRAIN__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    drivetrain.h
+  * @brief   Drivetrain kinematics, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/** @brief Maximum number of motors on one wheel (or side)
+ */
+#define DRIVE_WHEEL_MOTORS          3
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Drive types                                                         */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  An X-drive with a wheel at each corner uses the same mixing as a mecanum
+ *  drive, it is kept separate for clarity.
+ */
+typedef enum {
+    kDriveTank = 0,              ///< left and right wheels, tank or arcade control
+    kDriveMecanum,               ///< four wheels, forward, strafe and turn
+    kDriveXDrive                 ///< four omni wheels at 45 deg, as mecanum
+    } tDriveType;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Wheel positions, tank drives use front for the whole side           */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kDriveLeftFront = 0,
+    kDriveLeftBack,
+    kDriveRightFront,
+    kDriveRightBack,
+
+    kDriveWheelNum,
+
+    kDriveLeft  = kDriveLeftFront,
+    kDriveRight = kDriveRightFront
+    } tDriveWheel;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        DriveInit( tDriveType type, bool_t smart );
+void        DriveMotorAdd( tDriveWheel wheel, tVexMotor m );
+void        DriveFieldCentricSet( bool_t enable, bool_t reversed );
+void        DriveHeadingReset( void );
+void        DriveTank( int16_t left, int16_t right );
+void        DriveArcade( int16_t forward, int16_t turn );
+void        DriveHolonomic( int16_t forward, int16_t right, int16_t turn );
+void        DriveStop( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __DRIVETRAIN__
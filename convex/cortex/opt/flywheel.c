@@ -0,0 +1,579 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     flywheel.c                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Velocity control for flywheel launchers.  All flywheels are run from the */
+/*    system task immediately before motor data is sent, velocities are read   */
+/*    first, then all controllers are calculated and finally motors written.   */
+/*                                                                             */
+/*    Take back half integrates the error into the drive and, each time the    */
+/*    error changes sign, sets drive to half way between its present value and */
+/*    the value at the previous crossing.  Bang-bang switches between two      */
+/*    drive levels.  Feed forward and PI uses Kf * target plus a PI correction.*/
+/*                                                                             */
+/*    A shot shows up as a sudden drop in speed once the flywheel is at speed, */
+/*    the optional boost then applies a fixed drive until the speed recovers.  */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <math.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"
+
+#include "smartmotor.h"
+#include "flywheel.h"
+
+/*-----------------------------------------------------------------------------*/
+/** @file    flywheel.c
+  * @brief   Flywheel velocity control
+*//*---------------------------------------------------------------------------*/
+
+// storage for all flywheels
+static  flywheelController  flywheels[ FLYWHEEL_MAX ];
+static  int16_t             nextFlywheel = 0;
+
+// function used to set motors
+static  void (*flywheelOutput)(int16_t index, int16_t value) = vexMotorSet;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize a flywheel controller                               */
+/** @param[in]  mode The control algorithm                                     */
+/** @param[in]  sensor The velocity source                                    */
+/** @param[in]  channel The IME channel or smart motor index                   */
+/** @returns    A pointer to the controller or NULL if none are left           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The controller is not run until FlywheelStart is called.  Defaults are a
+ *  light velocity filter, no boost and gains that need tuning.
+ */
+
+flywheelController *
+FlywheelInit( tFlywheelMode mode, tFlywheelSensor sensor, int16_t channel )
+{
+    flywheelController  *fw;
+    int16_t             i;
+
+    if( nextFlywheel == FLYWHEEL_MAX )
+        return( NULL );
+
+    fw = &flywheels[ nextFlywheel ];
+
+    fw->mode        = mode;
+    fw->sensor      = sensor;
+    fw->channel     = channel;
+    fw->gear_ratio  = 1.0;
+    for(i=0;i<FLYWHEEL_MOTORS;i++)
+        fw->motors[i] = kVexMotor_None;
+
+    fw->target      = 0;
+    fw->rpm_raw     = 0;
+    fw->rpm         = 0;
+    fw->filter      = 0.5;
+
+    fw->gain        = 0.0001;
+    fw->tbh         = 0;
+    fw->last_error  = 0;
+    fw->first_cross = TRUE;
+
+    fw->bb_high     = 1.0;
+    fw->bb_low      = 0;
+
+    fw->Kf          = 0;
+    fw->Kp          = 0;
+    fw->Ki          = 0;
+    fw->integral    = 0;
+
+    fw->boost_drop  = 0;
+    fw->boost_drive = 1.0;
+    fw->boost_ms    = 0;
+    fw->boosting    = FALSE;
+    fw->armed       = FALSE;
+    fw->boost_start = 0;
+    fw->shots       = 0;
+
+    fw->drive       = 0;
+    fw->last_time   = chTimeNow();
+
+    // set last, the executor may already be running
+    fw->enabled     = TRUE;
+    nextFlywheel++;
+
+    return( fw );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Add a motor that drives the flywheel                           */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  m the motor                                                    */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  With the smart motor sensor any motor other than the one with the
+ *  sensor is linked to it, so the smart motor library models its current
+ *  using the flywheel speed.
+ */
+
+void
+FlywheelMotorAdd( flywheelController *fw, tVexMotor m )
+{
+    int16_t i;
+
+    if( fw == NULL || m < kVexMotor_1 || m >= kVexMotorNum )
+        return;
+
+    for(i=0;i<FLYWHEEL_MOTORS;i++)
+        {
+        if( fw->motors[i] == m )
+            return;
+        if( fw->motors[i] == kVexMotor_None )
+            {
+            if( fw->sensor == kFlywheelSensorSmartMotor && m != fw->channel )
+                SmartMotorLinkMotors( fw->channel, m );
+            fw->motors[i] = m;
+            return;
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the gear ratio between sensor and flywheel                 */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  ratio flywheel rpm per sensor rpm                              */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelSetGearRatio( flywheelController *fw, float ratio )
+{
+    if( fw == NULL || ratio == 0 )
+        return;
+
+    fw->gear_ratio = ratio;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the velocity filter                                        */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  filter weight of each new reading, 1.0 is no filtering         */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelSetFilter( flywheelController *fw, float filter )
+{
+    if( fw == NULL || filter <= 0 || filter > 1.0 )
+        return;
+
+    fw->filter = filter;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the take back half gain                                    */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  gain drive per rpm of error per second                         */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelSetTbhGain( flywheelController *fw, float gain )
+{
+    if( fw == NULL )
+        return;
+
+    fw->gain = fabs( gain );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the bang-bang drive levels                                 */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  high drive when below target                                   */
+/** @param[in]  low drive when at or above target                              */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelSetBangBang( flywheelController *fw, float high, float low )
+{
+    if( fw == NULL )
+        return;
+
+    fw->bb_high = high;
+    fw->bb_low  = low;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the feed forward and PI constants                          */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  Kf drive per rpm of target                                     */
+/** @param[in]  Kp drive per rpm of error                                      */
+/** @param[in]  Ki drive per rpm of error per second                           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Kf is also used by take back half as the drive for the first crossing
+ *  which gets the flywheel close to speed much sooner.
+ */
+
+void
+FlywheelSetFeedForwardPI( flywheelController *fw, float Kf, float Kp, float Ki )
+{
+    if( fw == NULL )
+        return;
+
+    fw->Kf = Kf;
+    fw->Kp = Kp;
+    fw->Ki = Ki;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the recovery boost after a shot                            */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  drop rpm below target that is taken as a shot                  */
+/** @param[in]  drive drive used until the flywheel is back to speed           */
+/** @param[in]  ms maximum time to boost, 0 disables the boost                 */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelSetBoost( flywheelController *fw, float drop, float drive, int16_t ms )
+{
+    if( fw == NULL )
+        return;
+
+    fw->boost_drop  = fabs( drop );
+    fw->boost_drive = drive;
+    fw->boost_ms    = (ms > 0) ? ms : 0;
+    fw->boosting    = FALSE;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the target speed                                           */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  rpm the flywheel target in rpm, 0 stops the flywheel           */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelTargetSet( flywheelController *fw, float rpm )
+{
+    if( fw == NULL )
+        return;
+
+    if( rpm < 0 )
+        rpm = 0;
+
+    // new target, the next real crossing uses the estimated drive
+    // last_error is seeded so the first update is not seen as a crossing
+    if( rpm != fw->target )
+        {
+        fw->last_error  = rpm - fw->rpm;
+        fw->first_cross = TRUE;
+        fw->armed       = FALSE;
+        fw->boosting    = FALSE;
+        }
+
+    fw->target = rpm;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the filtered flywheel speed                                */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @returns    The speed in rpm                                               */
+/*-----------------------------------------------------------------------------*/
+
+float
+FlywheelGetRpm( flywheelController *fw )
+{
+    if( fw == NULL )
+        return( 0 );
+
+    return( fw->rpm );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Check if the flywheel is at speed                              */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  tolerance allowed error in rpm                                 */
+/** @returns    TRUE if at speed and not recovering from a shot                */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+FlywheelIsReady( flywheelController *fw, float tolerance )
+{
+    if( fw == NULL || fw->target == 0 || fw->boosting )
+        return( FALSE );
+
+    return( fabs( fw->target - fw->rpm ) <= tolerance );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Read and filter the flywheel velocity                          */
+/** @param[in]  fw pointer to the flywheel                                     */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_FlywheelSensorRead( flywheelController *fw )
+{
+    imeData *ime;
+    float   rpm = 0;
+
+    switch( fw->sensor )
+        {
+        case    kFlywheelSensorIme:
+            // IME rpm has no sign, use the change in count
+            if( (ime = vexImeGetPtr( fw->channel )) != NULL )
+                rpm = (ime->delta_count < 0) ? -ime->rpm : ime->rpm;
+            break;
+
+        case    kFlywheelSensorSmartMotor:
+            rpm = SmartMotorGetSpeed( fw->channel );
+            break;
+
+        default:
+            break;
+        }
+
+    fw->rpm_raw = rpm * fw->gear_ratio;
+    fw->rpm    += fw->filter * (fw->rpm_raw - fw->rpm);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate the drive for one flywheel                           */
+/** @param[in]  fw pointer to the flywheel                                     */
+/** @param[in]  dt time since the last update in seconds                       */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_FlywheelCalculate( flywheelController *fw, float dt )
+{
+    float   error = fw->target - fw->rpm;
+    float   drive = fw->drive;
+
+    if( fw->target == 0 )
+        {
+        fw->drive      = 0;
+        fw->tbh        = 0;
+        fw->integral   = 0;
+        // last_error is left for FlywheelTargetSet to seed
+        return;
+        }
+
+    // detect a shot once at speed
+    if( fw->boost_ms > 0 )
+        {
+        if( fw->boosting )
+            {
+            // back to speed or given up
+            if( error <= 0 || (systime_t)(chTimeNow() - fw->boost_start) > MS2ST(fw->boost_ms) )
+                {
+                fw->boosting = FALSE;
+                fw->armed    = FALSE;
+                }
+            else
+                {
+                fw->drive      = fw->boost_drive;
+                fw->last_error = error;
+                return;
+                }
+            }
+        else
+        if( fw->armed && error > fw->boost_drop )
+            {
+            fw->boosting    = TRUE;
+            fw->boost_start = chTimeNow();
+            fw->shots++;
+            fw->drive       = fw->boost_drive;
+            fw->last_error  = error;
+            return;
+            }
+        else
+        if( error <= (fw->boost_drop / 2) )
+            fw->armed = TRUE;
+        }
+
+    switch( fw->mode )
+        {
+        case    kFlywheelTbh:
+            drive += fw->gain * error * dt;
+            if( drive > 1.0 )
+                drive = 1.0;
+            if( drive < 0 )
+                drive = 0;
+
+            // crossed the target
+            if( (error > 0) != (fw->last_error > 0) )
+                {
+                if( fw->first_cross && fw->Kf > 0 )
+                    drive = fw->Kf * fw->target;
+                else
+                    drive = 0.5 * (drive + fw->tbh);
+                fw->first_cross = FALSE;
+                fw->tbh = drive;
+                }
+            break;
+
+        case    kFlywheelBangBang:
+            drive = (error > 0) ? fw->bb_high : fw->bb_low;
+            break;
+
+        case    kFlywheelFeedForwardPI:
+            drive = (fw->Kf * fw->target) + (fw->Kp * error) + fw->integral;
+
+            // only integrate when not saturated
+            if( (drive < 1.0 || error < 0) && (drive > 0 || error > 0) )
+                fw->integral += fw->Ki * error * dt;
+            break;
+
+        default:
+            drive = 0;
+            break;
+        }
+
+    if( drive > 1.0 )
+        drive = 1.0;
+    if( drive < 0 )
+        drive = 0;
+
+    fw->drive      = drive;
+    fw->last_error = error;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Run all flywheels, called from the system task                 */
+/*-----------------------------------------------------------------------------*/
+
+static void
+FlywheelExecutor(void)
+{
+    flywheelController  *fw;
+    systime_t           now = chTimeNow();
+    int16_t             i, m;
+    float               dt;
+
+    // read all sensors
+    for(i=0;i<nextFlywheel;i++)
+        {
+        fw = &flywheels[i];
+        if( fw->enabled )
+            _FlywheelSensorRead( fw );
+        }
+
+    // calculate
+    for(i=0;i<nextFlywheel;i++)
+        {
+        fw = &flywheels[i];
+        if( !fw->enabled )
+            continue;
+
+        dt = (float)(systime_t)(now - fw->last_time) / CH_FREQUENCY;
+        fw->last_time = now;
+        _FlywheelCalculate( fw, dt );
+        }
+
+    // send to motors
+    for(i=0;i<nextFlywheel;i++)
+        {
+        fw = &flywheels[i];
+        if( !fw->enabled )
+            continue;
+
+        for(m=0;m<FLYWHEEL_MOTORS;m++)
+            {
+            if( fw->motors[m] != kVexMotor_None )
+                flywheelOutput( fw->motors[m], (int16_t)(fw->drive * 127) );
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the function used to set motors                            */
+/** @param[in]  pf the function, NULL restores vexMotorSet                     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  If the smart motor library is running then motors must be set through it
+ *  rather than directly, use a small wrapper around SetMotor.
+ */
+
+void
+FlywheelOutputSet( void (*pf)(int16_t index, int16_t value) )
+{
+    if( pf == NULL )
+        flywheelOutput = vexMotorSet;
+    else
+        flywheelOutput = pf;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start running all flywheels                                    */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelStart()
+{
+    int16_t i;
+
+    for(i=0;i<nextFlywheel;i++)
+        flywheels[i].last_time = chTimeNow();
+
+    vexSystemTickCallbackAdd( FlywheelExecutor );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop all flywheels and their motors                            */
+/*-----------------------------------------------------------------------------*/
+
+void
+FlywheelStop()
+{
+    flywheelController  *fw;
+    int16_t             i, m;
+
+    vexSystemTickCallbackRemove( FlywheelExecutor );
+
+    for(i=0;i<nextFlywheel;i++)
+        {
+        fw = &flywheels[i];
+        fw->drive = 0;
+
+        for(m=0;m<FLYWHEEL_MOTORS;m++)
+            {
+            if( fw->motors[m] != kVexMotor_None )
+                flywheelOutput( fw->motors[m], 0 );
+            }
+        }
+}
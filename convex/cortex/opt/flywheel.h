@@ -0,0 +1,153 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     flywheel.h                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __FLYWHEEL__
+#define __FLYWHEEL__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    flywheel.h
+  * @brief   Flywheel velocity control, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/** @brief Maximum number of flywheel controllers
+ */
+#define FLYWHEEL_MAX                2
+
+/** @brief Maximum number of motors driving one flywheel
+ */
+#define FLYWHEEL_MOTORS             4
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Control algorithm                                                   */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kFlywheelTbh = 0,               ///< integrate error, take back half on crossing
+    kFlywheelBangBang,              ///< high drive below target, low drive above
+    kFlywheelFeedForwardPI          ///< feed forward from target plus PI
+    } tFlywheelMode;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Where the velocity comes from                                       */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kFlywheelSensorIme = 0,         ///< IME velocity, channel is the IME
+    kFlywheelSensorSmartMotor       ///< smart motor speed, channel is the motor
+    } tFlywheelSensor;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Structure to hold all data for one flywheel                         */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Velocities are rpm of the flywheel, drive is 0 to 1.0.  A flywheel is
+ *  only ever driven forwards, use a negative gear ratio if the sensor
+ *  counts backwards.
+ */
+typedef struct _flywheelController {
+    tFlywheelMode    mode;          ///< control algorithm
+    tFlywheelSensor  sensor;        ///< velocity source
+    int16_t          channel;       ///< IME channel or smart motor index
+    float            gear_ratio;    ///< flywheel rpm per sensor rpm
+    tVexMotor        motors[ FLYWHEEL_MOTORS ];
+
+    // velocity
+    float            target;        ///< target rpm
+    float            rpm_raw;       ///< last velocity read
+    float            rpm;           ///< filtered velocity
+    float            filter;        ///< weight of each new reading, 0 to 1.0
+
+    // take back half
+    float            gain;          ///< drive per rpm error per second
+    float            tbh;           ///< drive at the last crossing
+    float            last_error;
+    bool_t           first_cross;   ///< next crossing uses the estimated drive
+
+    // bang-bang
+    float            bb_high;       ///< drive below target
+    float            bb_low;        ///< drive at or above target
+
+    // feed forward and PI, Kf is also the tbh estimate
+    float            Kf;            ///< drive per rpm of target
+    float            Kp;            ///< drive per rpm error
+    float            Ki;            ///< drive per rpm error per second
+    float            integral;
+
+    // recovery after a shot
+    float            boost_drop;    ///< rpm below target that starts a boost
+    float            boost_drive;   ///< drive while boosting
+    int16_t          boost_ms;      ///< maximum boost time, 0 disables
+    bool_t           boosting;
+    bool_t           armed;         ///< at speed, a drop now is a shot
+    systime_t        boost_start;
+    uint16_t         shots;         ///< number of boosts
+
+    float            drive;         ///< output 0 to 1.0
+    bool_t           enabled;
+    systime_t        last_time;     ///< time of the last update
+    } flywheelController;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+flywheelController *FlywheelInit( tFlywheelMode mode, tFlywheelSensor sensor, int16_t channel );
+void        FlywheelMotorAdd( flywheelController *fw, tVexMotor m );
+void        FlywheelSetGearRatio( flywheelController *fw, float ratio );
+void        FlywheelSetFilter( flywheelController *fw, float filter );
+void        FlywheelSetTbhGain( flywheelController *fw, float gain );
+void        FlywheelSetBangBang( flywheelController *fw, float high, float low );
+void        FlywheelSetFeedForwardPI( flywheelController *fw, float Kf, float Kp, float Ki );
+void        FlywheelSetBoost( flywheelController *fw, float drop, float drive, int16_t ms );
+void        FlywheelTargetSet( flywheelController *fw, float rpm );
+float       FlywheelGetRpm( flywheelController *fw );
+bool_t      FlywheelIsReady( flywheelController *fw, float tolerance );
+void        FlywheelOutputSet( void (*pf)(int16_t index, int16_t value) );
+void        FlywheelStart( void );
+void        FlywheelStop( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __FLYWHEEL__
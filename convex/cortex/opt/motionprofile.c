@@ -0,0 +1,461 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     motionprofile.c                                              */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    A profile is planned once when a move is started as a list of segments   */
+/*    of constant jerk.  A trapezoid has three segments (accelerate, cruise,   */
+/*    decelerate) with an instantaneous change of acceleration between them,   */
+/*    an S-curve has seven segments with jerk limited ramps of acceleration.   */
+/*    Short moves that can't reach the velocity (or acceleration) limit are    */
+/*    planned with reduced peak velocity.                                      */
+/*                                                                             */
+/*    Each control tick the state is integrated exactly over the elapsed time, */
+/*    splitting the step at segment boundaries, so only a few multiplies are   */
+/*    needed per update and the update rate can vary.                          */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <math.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"
+
+#include "motionprofile.h"
+
+/*-----------------------------------------------------------------------------*/
+/** @file    motionprofile.c
+  * @brief   Trapezoidal and S-curve motion profiles
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize a motion profile                                    */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  type kMotionProfileTrapezoidal or kMotionProfileSCurve         */
+/** @param[in]  max_vel maximum velocity in counts/sec                         */
+/** @param[in]  max_acc maximum acceleration in counts/sec^2                   */
+/** @param[in]  max_jerk maximum jerk in counts/sec^3, S-curve only            */
+/*-----------------------------------------------------------------------------*/
+
+void
+MotionProfileInit( motionProfile *mp, tMotionProfileType type, float max_vel, float max_acc, float max_jerk )
+{
+    if( mp == NULL )
+        return;
+
+    mp->type      = type;
+    mp->max_vel   = fabs( max_vel );
+    mp->max_acc   = fabs( max_acc );
+    mp->max_jerk  = fabs( max_jerk );
+
+    // S-curve without a jerk limit is a trapezoid
+    if( mp->max_jerk == 0 )
+        mp->type = kMotionProfileTrapezoidal;
+
+    mp->Kv        = 0;
+    mp->Ka        = 0;
+
+    mp->nseg      = 0;
+    mp->current   = 0;
+    mp->seg_time  = 0;
+    mp->direction = 1;
+    mp->start     = 0;
+    mp->end       = 0;
+    mp->pos       = 0;
+    mp->vel       = 0;
+    mp->acc       = 0;
+    mp->active    = FALSE;
+    mp->last_time = 0;
+    mp->pid       = NULL;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set feed forward constants                                     */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  Kv drive (+/- 1.0) per count/sec of velocity                   */
+/** @param[in]  Ka drive (+/- 1.0) per count/sec^2 of acceleration             */
+/*-----------------------------------------------------------------------------*/
+
+void
+MotionProfileSetFeedForward( motionProfile *mp, float Kv, float Ka )
+{
+    if( mp == NULL )
+        return;
+
+    mp->Kv = Kv;
+    mp->Ka = Ka;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Have a profile drive a pid controller target                   */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  p pointer to the pid controller                                */
+/*-----------------------------------------------------------------------------*/
+
+/*  called by the pid controller immediately before each calculation          */
+static void
+_MotionProfilePidSetpoint( pidController *p, void *arg )
+{
+    motionProfile   *mp = (motionProfile *)arg;
+    systime_t        now = chTimeNow();
+
+    if( !mp->active )
+        {
+        p->feedforward = 0;
+        return;
+        }
+
+    MotionProfileUpdate( mp, (float)(systime_t)(now - mp->last_time) / CH_FREQUENCY );
+    mp->last_time = now;
+
+    p->target_value = (int32_t)lroundf( mp->pos );
+    if( mp->active )
+        p->feedforward = (mp->Kv * mp->vel) + (mp->Ka * mp->acc);
+    else
+        p->feedforward = 0;
+}
+
+/** @details
+ *  Once attached the profile is advanced whenever the controller is updated,
+ *  either by PidControllerUpdate from a user task or by the batch executor,
+ *  so target and feed forward always match the sensor reading.
+ */
+
+void
+MotionProfileAttach( motionProfile *mp, pidController *p )
+{
+    if( mp == NULL || p == NULL )
+        return;
+
+    mp->pid         = p;
+    p->setpoint_arg = mp;
+    p->setpoint     = _MotionProfilePidSetpoint;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop a profile driving a pid controller                        */
+/** @param[in]  mp pointer to the profile                                      */
+/*-----------------------------------------------------------------------------*/
+
+void
+MotionProfileDetach( motionProfile *mp )
+{
+    if( mp == NULL || mp->pid == NULL )
+        return;
+
+    mp->pid->setpoint    = NULL;
+    mp->pid->feedforward = 0;
+    mp->pid = NULL;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Add a segment to the plan                                      */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_MotionProfileAddSegment( motionProfile *mp, float time, float jerk, float acc )
+{
+    if( time <= 0 || mp->nseg >= MOTION_PROFILE_SEGMENTS )
+        return;
+
+    mp->seg[ mp->nseg ].time = time;
+    mp->seg[ mp->nseg ].jerk = jerk;
+    mp->seg[ mp->nseg ].acc  = acc;
+    mp->nseg++;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Plan a trapezoidal move of distance d (positive)               */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_MotionProfilePlanTrapezoid( motionProfile *mp, float d )
+{
+    float   v  = mp->max_vel;
+    float   a  = mp->max_acc;
+    float   ta, tc;
+
+    // can't reach full speed, triangular profile
+    if( v * v / a > d )
+        v = sqrtf( d * a );
+
+    ta = v / a;
+    tc = (d - v * ta) / v;
+
+    _MotionProfileAddSegment( mp, ta, 0,  a );
+    _MotionProfileAddSegment( mp, tc, 0,  0 );
+    _MotionProfileAddSegment( mp, ta, 0, -a );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Plan an S-curve move of distance d (positive)                  */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_MotionProfilePlanSCurve( motionProfile *mp, float d )
+{
+    float   v  = mp->max_vel;
+    float   a  = mp->max_acc;
+    float   j  = mp->max_jerk;
+    float   tj, ta, tc;
+
+    // distance to reach v and stop again is v * (2tj + ta)
+    // where tj is the jerk time and ta is the constant acceleration time
+    if( v * j < a * a )
+        {
+        // acceleration limit not reached
+        tj = sqrtf( v / j );
+        ta = 0;
+        }
+    else
+        {
+        tj = a / j;
+        ta = v / a - tj;
+        }
+
+    if( v * (2 * tj + ta) > d )
+        {
+        // can't reach full speed, reduce peak velocity
+        v = (a / 2) * ( sqrtf( (a * a) / (j * j) + 4 * d / a ) - a / j );
+
+        if( v * j < a * a )
+            {
+            v  = cbrtf( (d * d * j) / 4 );
+            tj = sqrtf( v / j );
+            ta = 0;
+            }
+        else
+            {
+            tj = a / j;
+            ta = v / a - tj;
+            }
+        }
+
+    // peak acceleration actually used
+    a  = j * tj;
+    tc = (d - v * (2 * tj + ta)) / v;
+
+    _MotionProfileAddSegment( mp, tj,  j,  0 );
+    _MotionProfileAddSegment( mp, ta,  0,  a );
+    _MotionProfileAddSegment( mp, tj, -j,  a );
+    _MotionProfileAddSegment( mp, tc,  0,  0 );
+    _MotionProfileAddSegment( mp, tj, -j,  0 );
+    _MotionProfileAddSegment( mp, ta,  0, -a );
+    _MotionProfileAddSegment( mp, tj,  j, -a );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start a move                                                   */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  from start position                                            */
+/** @param[in]  to end position                                                */
+/*-----------------------------------------------------------------------------*/
+
+void
+MotionProfileStart( motionProfile *mp, float from, float to )
+{
+    float   d;
+
+    if( mp == NULL )
+        return;
+
+    // stop any current move while planning
+    mp->active    = FALSE;
+
+    mp->start     = from;
+    mp->end       = to;
+    mp->direction = (to >= from) ? 1 : -1;
+    mp->pos       = from;
+    mp->vel       = 0;
+    mp->acc       = 0;
+    mp->nseg      = 0;
+    mp->current   = 0;
+    mp->seg_time  = 0;
+
+    d = fabs( to - from );
+    if( d == 0 || mp->max_vel == 0 || mp->max_acc == 0 )
+        {
+        mp->pos = to;
+        return;
+        }
+
+    if( mp->type == kMotionProfileSCurve )
+        _MotionProfilePlanSCurve( mp, d );
+    else
+        _MotionProfilePlanTrapezoid( mp, d );
+
+    mp->last_time = chTimeNow();
+    mp->active    = TRUE;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start a move from the current position                         */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  to end position                                                */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Starts from the current setpoint, or from the sensor if the attached
+ *  controller is idle.  A move started while another is running begins
+ *  from rest at the current setpoint.
+ */
+
+void
+MotionProfileMoveTo( motionProfile *mp, float to )
+{
+    float   from;
+
+    if( mp == NULL )
+        return;
+
+    if( !mp->active && mp->pid != NULL )
+        from = mp->pid->sensor_value;
+    else
+        from = mp->pos;
+
+    MotionProfileStart( mp, from, to );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Advance the profile                                            */
+/** @param[in]  mp pointer to the profile                                      */
+/** @param[in]  dt time since the last update in seconds                      */
+/** @returns    TRUE while the move is in progress                             */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+MotionProfileUpdate( motionProfile *mp, float dt )
+{
+    motionSegment   *s;
+    float            t;
+    float            p, v, a;
+
+    if( mp == NULL || !mp->active )
+        return( FALSE );
+
+    // work in the positive direction
+    p = (mp->pos - mp->start) * mp->direction;
+    v = mp->vel * mp->direction;
+    a = mp->acc * mp->direction;
+
+    while( dt > 0 && mp->current < mp->nseg )
+        {
+        s = &mp->seg[ mp->current ];
+
+        // new segment, acceleration is set rather than integrated
+        // to avoid accumulating errors
+        if( mp->seg_time == 0 )
+            a = s->acc;
+
+        // time to integrate in this segment
+        t = s->time - mp->seg_time;
+        if( t > dt )
+            t = dt;
+
+        p += (v * t) + (a * t * t / 2) + (s->jerk * t * t * t / 6);
+        v += (a * t) + (s->jerk * t * t / 2);
+        a += (s->jerk * t);
+
+        dt -= t;
+        mp->seg_time += t;
+
+        if( mp->seg_time >= s->time )
+            {
+            mp->current++;
+            mp->seg_time = 0;
+            }
+        }
+
+    if( mp->current >= mp->nseg )
+        {
+        // done, finish exactly at the end point
+        mp->pos    = mp->end;
+        mp->vel    = 0;
+        mp->acc    = 0;
+        mp->active = FALSE;
+        }
+    else
+        {
+        mp->pos = mp->start + p * mp->direction;
+        mp->vel = v * mp->direction;
+        mp->acc = a * mp->direction;
+        }
+
+    return( mp->active );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Check for the end of a move                                    */
+/** @param[in]  mp pointer to the profile                                      */
+/** @returns    TRUE if no move is in progress                                 */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+MotionProfileIsDone( motionProfile *mp )
+{
+    if( mp == NULL )
+        return( TRUE );
+
+    return( !mp->active );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the total time of the planned move                         */
+/** @param[in]  mp pointer to the profile                                      */
+/** @returns    duration in seconds                                            */
+/*-----------------------------------------------------------------------------*/
+
+float
+MotionProfileDuration( motionProfile *mp )
+{
+    int16_t  i;
+    float    t = 0;
+
+    if( mp == NULL )
+        return( 0 );
+
+    for(i=0;i<mp->nseg;i++)
+        t += mp->seg[i].time;
+
+    return( t );
+}
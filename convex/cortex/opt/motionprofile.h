@@ -0,0 +1,133 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     motionprofile.h                                              */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __MOTIONPROFILE__
+#define __MOTIONPROFILE__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    motionprofile.h
+  * @brief   Trapezoidal and S-curve motion profiles, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+#include "pidlib.h"
+
+/** @brief Maximum number of segments in a profile, 7 for an S-curve
+ */
+#define MOTION_PROFILE_SEGMENTS     7
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Type of profile                                                     */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kMotionProfileTrapezoidal = 0, ///< velocity and acceleration limited
+    kMotionProfileSCurve           ///< velocity, acceleration and jerk limited
+    } tMotionProfileType;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief One segment of constant jerk                                        */
+/*-----------------------------------------------------------------------------*/
+typedef struct _motionSegment {
+    float        time;           ///< duration in seconds
+    float        jerk;           ///< jerk during the segment
+    float        acc;            ///< acceleration at the start of the segment
+    } motionSegment;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Structure to hold all data for one motion profile                   */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Units are sensor units (counts) and seconds.  Profiles always start and
+ *  end at rest.
+ */
+typedef struct _motionProfile {
+    tMotionProfileType type;     ///< trapezoidal or S-curve
+
+    // limits
+    float        max_vel;        ///< maximum velocity, counts/sec
+    float        max_acc;        ///< maximum acceleration, counts/sec^2
+    float        max_jerk;       ///< maximum jerk, counts/sec^3
+
+    // feed forward constants
+    float        Kv;             ///< drive per count/sec
+    float        Ka;             ///< drive per count/sec^2
+
+    // the planned move
+    motionSegment seg[ MOTION_PROFILE_SEGMENTS ];
+    int16_t      nseg;           ///< number of segments
+    int16_t      current;        ///< current segment
+    float        seg_time;       ///< time into the current segment
+    float        direction;      ///< +1 or -1
+    float        start;          ///< start position
+    float        end;            ///< end position
+
+    // current setpoint
+    float        pos;            ///< position
+    float        vel;            ///< velocity
+    float        acc;            ///< acceleration
+    bool_t       active;         ///< a move is in progress
+
+    systime_t    last_time;      ///< time of the last update
+    pidController *pid;          ///< controller driven by this profile
+    } motionProfile;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        MotionProfileInit( motionProfile *mp, tMotionProfileType type, float max_vel, float max_acc, float max_jerk );
+void        MotionProfileSetFeedForward( motionProfile *mp, float Kv, float Ka );
+void        MotionProfileAttach( motionProfile *mp, pidController *p );
+void        MotionProfileDetach( motionProfile *mp );
+void        MotionProfileStart( motionProfile *mp, float from, float to );
+void        MotionProfileMoveTo( motionProfile *mp, float to );
+bool_t      MotionProfileUpdate( motionProfile *mp, float dt );
+bool_t      MotionProfileIsDone( motionProfile *mp );
+float       MotionProfileDuration( motionProfile *mp );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __MOTIONPROFILE__
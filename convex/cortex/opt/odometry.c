@@ -0,0 +1,516 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     odometry.c                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Dead reckoning from drive wheel encoders (IMEs or quad encoders) with    */
+/*    heading from the gyro.  Runs as its own thread at a fixed rate using     */
+/*    only integer arithmetic.                                                 */
+/*                                                                             */
+/*    Heading is kept internally with 2^32 units per revolution so rounding    */
+/*    does not accumulate, and is published with 65536 per revolution.         */
+/*    Heading follows the difference between left and right wheels and a       */
+/*    complementary filter pulls it towards the gyro heading with a time       */
+/*    constant, so heading error from wheel slip is removed over time.  The    */
+/*    position is integrated along the heading at the middle of the update.    */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "ch.h"         // needs for all ChibiOS programs
+#include "hal.h"        // hardware abstraction layer header
+#include "vex.h"        // vex library header
+#include "vexgyro.h"
+#include "odometry.h"
+
+/*-----------------------------------------------------------------------------*/
+/** @file    odometry.c
+  * @brief   Wheel odometry and pose estimation
+*//*---------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/*  Quarter wave sine table, Q15, 64 steps                                     */
+/*-----------------------------------------------------------------------------*/
+static const int16_t odoSinLut[65] = {
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+     6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Holds information for one wheel                                */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    tVexSensors  port;           ///< IME or quad encoder sensor
+    bool_t       installed;      ///< wheel has an encoder
+    bool_t       reversed;       ///< encoder counts backwards
+    int32_t      last;           ///< count at the last update
+    } odometryWheel;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      All odometry state                                             */
+/*-----------------------------------------------------------------------------*/
+typedef struct {
+    tOdometryDrive drive;
+    odometryWheel  wheels[ kOdometryWheelNum ];
+
+    int32_t      unit_per_tick;  ///< Q16.16 units for one encoder tick
+    int64_t      turn_k;         ///< heading (2^32/rev) per unit of wheel difference
+
+    bool_t       gyro;           ///< gyro used for heading
+    bool_t       gyro_reverse;   ///< gyro counts clockwise
+    int32_t      gyro_k;         ///< Q16 share of the gyro error removed each update
+    int32_t      gyro_tau;       ///< filter time constant in mS, for debug
+    int32_t      gyro_last;      ///< gyro reading at the last update
+    int64_t      gyro_heading;   ///< heading from the gyro alone, 2^32 per revolution
+
+    int64_t      heading;        ///< heading, 2^32 per revolution
+    int32_t      x;              ///< Q16.16
+    int32_t      y;              ///< Q16.16
+
+    odometryPose pose;           ///< published snapshot
+    } odometryData;
+
+static  odometryData    odo;
+
+static WORKING_AREA(waOdometryTask, ODOMETRY_TASK_STACK_SIZE);
+static Thread *odometryThread = NULL;
+static vexPerfPeriodic odometryPerf;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Fixed point sine                                               */
+/** @param[in]  angle 65536 per revolution                                     */
+/** @returns    sine as Q15                                                    */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+OdometrySin( uint16_t angle )
+{
+    uint16_t    q    = angle >> 14;         // quadrant
+    uint16_t    a    = angle & 0x3FFF;      // angle within quadrant
+    uint16_t    i;
+    int32_t     frac;
+    int32_t     v;
+
+    // second and fourth quadrants run backwards through the table
+    if( q & 1 )
+        a = 0x4000 - a;
+
+    i    = a >> 8;
+    frac = a & 0xFF;
+    if( i >= 64 )
+        v = odoSinLut[64];
+    else
+        v = odoSinLut[i] + (((odoSinLut[i+1] - odoSinLut[i]) * frac) >> 8);
+
+    return( (q & 2) ? -v : v );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Fixed point cosine                                             */
+/** @param[in]  angle 65536 per revolution                                     */
+/** @returns    cosine as Q15                                                  */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+OdometryCos( uint16_t angle )
+{
+    return( OdometrySin( angle + 0x4000 ) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize odometry                                            */
+/** @param[in]  drive kOdometryTank or kOdometryMecanum                         */
+/** @param[in]  ticks_per_unit encoder ticks per unit of distance              */
+/** @param[in]  track distance between left and right wheels in units          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  For a mecanum drive use track width plus wheel base for track as all four
+ *  wheels contribute to turning.  The units chosen here (inches, cm) are the
+ *  units of the pose.
+ */
+
+void
+OdometryInit( tOdometryDrive drive, float ticks_per_unit, float track )
+{
+    int16_t     i;
+
+    OdometryStop();
+
+    odo.drive = drive;
+
+    for(i=0;i<kOdometryWheelNum;i++)
+        odo.wheels[i].installed = FALSE;
+
+    if( ticks_per_unit <= 0 || track <= 0 )
+        return;
+
+    // floats only used here, turn_k is 64 bit as it passes 2^31 when the
+    // track is less than about 0.32 units
+    odo.unit_per_tick = (int32_t)(65536.0 / ticks_per_unit);
+    odo.turn_k        = (int64_t)(4294967296.0 / (2.0 * 3.14159265 * track));
+
+    odo.gyro          = FALSE;
+    odo.gyro_reverse  = FALSE;
+    odo.gyro_k        = 0;
+    odo.gyro_tau      = 0;
+
+    OdometrySetPose( 0, 0, 0 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the encoder used for a wheel                               */
+/** @param[in]  wheel the wheel position                                       */
+/** @param[in]  port the IME or quad encoder sensor, eg. kVexSensorIme_1       */
+/** @param[in]  reversed TRUE if the count decreases when driving forwards     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A tank drive needs at least one wheel on each side, wheels on the same
+ *  side are averaged.  A mecanum drive needs all four to measure strafe,
+ *  with fewer it is treated as a tank drive.
+ */
+
+void
+OdometryWheelSet( tOdometryWheel wheel, tVexSensors port, bool_t reversed )
+{
+    if( wheel >= kOdometryWheelNum )
+        return;
+
+    odo.wheels[wheel].port      = port;
+    odo.wheels[wheel].reversed  = reversed;
+    odo.wheels[wheel].last      = vexSensorValueGet( port );
+    odo.wheels[wheel].installed = TRUE;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Use the gyro for heading                                       */
+/** @param[in]  enable TRUE to use the gyro started with vexGyroInit           */
+/** @param[in]  reversed TRUE if the gyro reading increases clockwise          */
+/** @param[in]  tau filter time constant in seconds, 0 uses the gyro alone     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Complementary filter, heading follows the wheels over short times and
+ *  is pulled towards the gyro heading with time constant tau, so heading
+ *  error from wheel slip does not accumulate.  Wheels slip a lot when
+ *  turning, 0.25 seconds is a reasonable starting point.
+ */
+
+void
+OdometryGyroSet( bool_t enable, bool_t reversed, float tau )
+{
+    float   dt = ODOMETRY_PERIOD_MS / 1000.0;
+
+    if( tau < 0 )
+        tau = 0;
+
+    chSysLock();
+    odo.gyro_reverse = reversed;
+    odo.gyro_k       = (int32_t)(65536.0 * dt / (tau + dt));
+    odo.gyro_tau     = (int32_t)(tau * 1000);
+    odo.gyro_last    = vexGyroGet();
+    odo.gyro_heading = odo.heading;
+    odo.gyro         = enable;
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Read a wheel and return the change in Q16.16 units             */
+/*-----------------------------------------------------------------------------*/
+
+static int32_t
+_OdometryWheelDelta( odometryWheel *w )
+{
+    int32_t     count, delta;
+
+    count   = vexSensorValueGet( w->port );
+    delta   = count - w->last;
+    w->last = count;
+
+    if( w->reversed )
+        delta = -delta;
+
+    return( delta * odo.unit_per_tick );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Average of the installed wheels on one side                    */
+/*-----------------------------------------------------------------------------*/
+
+static int32_t
+_OdometrySideDelta( odometryWheel *front, odometryWheel *back )
+{
+    if( front->installed && back->installed )
+        return( (_OdometryWheelDelta( front ) + _OdometryWheelDelta( back )) / 2 );
+    if( front->installed )
+        return( _OdometryWheelDelta( front ) );
+    if( back->installed )
+        return( _OdometryWheelDelta( back ) );
+
+    return( 0 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      One odometry update                                            */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_OdometryUpdate( systime_t now )
+{
+    odometryWheel  *w = odo.wheels;
+    int32_t         left, right;
+    int32_t         forward, strafe = 0;
+    int64_t         d_enc, d_gyro, d_theta;
+    int32_t         gyro;
+    uint16_t        mid;
+    int32_t         s, c;
+
+    // wheel motion in robot coordinates
+    if( odo.drive == kOdometryMecanum &&
+        w[kOdometryLeftFront].installed  && w[kOdometryLeftBack].installed &&
+        w[kOdometryRightFront].installed && w[kOdometryRightBack].installed )
+        {
+        int32_t lf = _OdometryWheelDelta( &w[kOdometryLeftFront] );
+        int32_t lb = _OdometryWheelDelta( &w[kOdometryLeftBack] );
+        int32_t rf = _OdometryWheelDelta( &w[kOdometryRightFront] );
+        int32_t rb = _OdometryWheelDelta( &w[kOdometryRightBack] );
+
+        left    = (lf + lb) / 2;
+        right   = (rf + rb) / 2;
+        // positive strafe is to the right
+        strafe  = (lf - lb - rf + rb) / 4;
+        }
+    else
+        {
+        left    = _OdometrySideDelta( &w[kOdometryLeftFront],  &w[kOdometryLeftBack] );
+        right   = _OdometrySideDelta( &w[kOdometryRightFront], &w[kOdometryRightBack] );
+        }
+
+    forward = (left + right) / 2;
+
+    // heading change from the wheels, counter clockwise positive
+    d_enc = ((int64_t)(right - left) * odo.turn_k) >> 16;
+
+    d_theta = d_enc;
+
+    // complementary filter, remove part of the difference between the
+    // gyro heading and the wheel heading, wheels only while the gyro is
+    // still calibrating
+    if( odo.gyro )
+        {
+        gyro   = vexGyroGet();
+        d_gyro = (int64_t)(gyro - odo.gyro_last) * 1193046;   // 2^32 / 3600
+        odo.gyro_last = gyro;
+        if( odo.gyro_reverse )
+            d_gyro = -d_gyro;
+
+        if( vexGyroReady() )
+            {
+            odo.gyro_heading += d_gyro;
+            d_theta += ((odo.gyro_heading - (odo.heading + d_enc)) * odo.gyro_k) >> 16;
+            }
+        else
+            odo.gyro_heading = odo.heading + d_enc;
+        }
+
+    // integrate along the mid point heading
+    mid = (uint16_t)((odo.heading + d_theta / 2) >> 16);
+    s   = OdometrySin( mid );
+    c   = OdometryCos( mid );
+
+    odo.x += (int32_t)(((int64_t)forward * c + (int64_t)strafe * s) >> 15);
+    odo.y += (int32_t)(((int64_t)forward * s - (int64_t)strafe * c) >> 15);
+    odo.heading += d_theta;
+
+    // publish
+    chSysLock();
+    odo.pose.x     = odo.x;
+    odo.pose.y     = odo.y;
+    odo.pose.theta = (int32_t)(odo.heading >> 16);
+    odo.pose.time  = now;
+    odo.pose.seq++;
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Odometry thread                                                            */
+/*-----------------------------------------------------------------------------*/
+
+static msg_t
+OdometryTask( void *arg )
+{
+    systime_t   time;
+
+    (void)arg;
+    chRegSetThreadName("odometry");
+    vexPerfPeriodicInit( &odometryPerf, "odometry", ODOMETRY_PERIOD_MS * 1000, 0 );
+
+    time = chTimeNow();
+
+    while(!chThdShouldTerminate())
+        {
+        vexPerfPeriodicStart( &odometryPerf );
+        _OdometryUpdate( chTimeNow() );
+        vexPerfPeriodicEnd( &odometryPerf );
+
+        time += MS2ST(ODOMETRY_PERIOD_MS);
+        if( (systime_t)(time - chTimeNow()) <= (systime_t)MS2ST(ODOMETRY_PERIOD_MS) )
+            chThdSleepUntil(time);
+        else
+            time = chTimeNow();
+        }
+
+    return( (msg_t)0 );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start odometry updates                                         */
+/*-----------------------------------------------------------------------------*/
+
+void
+OdometryRun()
+{
+    int16_t     i;
+
+    if( odometryThread != NULL )
+        return;
+
+    // don't count anything that happened before now
+    for(i=0;i<kOdometryWheelNum;i++)
+        {
+        if( odo.wheels[i].installed )
+            odo.wheels[i].last = vexSensorValueGet( odo.wheels[i].port );
+        }
+    odo.gyro_last = vexGyroGet();
+
+    odometryThread = chThdCreateStatic(waOdometryTask, sizeof(waOdometryTask), ODOMETRY_THREAD_PRIORITY, OdometryTask, NULL);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop odometry updates                                          */
+/*-----------------------------------------------------------------------------*/
+
+void
+OdometryStop()
+{
+    if( odometryThread != NULL )
+        {
+        chThdTerminate(odometryThread);
+        chThdWait(odometryThread);
+        odometryThread = NULL;
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the latest pose                                            */
+/** @param[out] pose pointer to storage for the pose                           */
+/*-----------------------------------------------------------------------------*/
+
+void
+OdometryGetPose( odometryPose *pose )
+{
+    if( pose == NULL )
+        return;
+
+    chSysLock();
+    *pose = odo.pose;
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the current pose                                           */
+/** @param[in]  x x position Q16.16                                            */
+/** @param[in]  y y position Q16.16                                            */
+/** @param[in]  theta heading, ODOMETRY_ANGLE_REV per revolution               */
+/*-----------------------------------------------------------------------------*/
+
+void
+OdometrySetPose( int32_t x, int32_t y, int32_t theta )
+{
+    chSysLock();
+    odo.x          = x;
+    odo.y          = y;
+    odo.heading    = (int64_t)theta << 16;
+    odo.gyro_heading = odo.heading;
+    odo.pose.x     = x;
+    odo.pose.y     = y;
+    odo.pose.theta = theta;
+    odo.pose.time  = chTimeNow();
+    chSysUnlock();
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Send the current pose to the debug console                     */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+
+void
+OdometryDebug(vexStream *chp, int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    odometryPose    pose;
+    int16_t         i;
+
+    OdometryGetPose( &pose );
+
+    vex_chprintf(chp,"x %ld y %ld theta %ld (deg*10) ", ODOMETRY_POS_TO_UNITS(pose.x), ODOMETRY_POS_TO_UNITS(pose.y), ODOMETRY_ANGLE_TO_DEG10(pose.theta) );
+    vex_chprintf(chp,"time %lu seq %lu\r\n", pose.time, pose.seq );
+
+    for(i=0;i<kOdometryWheelNum;i++)
+        {
+        if( odo.wheels[i].installed )
+            vex_chprintf(chp,"W%d port %2d %s %8ld\r\n", i, odo.wheels[i].port, odo.wheels[i].reversed ? "rev" : "   ", odo.wheels[i].last );
+        }
+    if( odo.gyro )
+        vex_chprintf(chp,"gyro %ld tau %ldmS\r\n", odo.gyro_last, odo.gyro_tau );
+}
@@ -0,0 +1,134 @@
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*                        Copyright (c) James Pearman                          */
+/*                                   2026                                      */
+/*                            All Rights Reserved                              */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    Module:     odometry.h                                                   */
+/*    Author:     James Pearman                                                */
+/*    Created:    19 Oct 2026                                                  */
+/*                                                                             */
+/*    Revisions:                                                               */
+/*                V1.00     19 Oct 2026 - Initial release                      */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+/*                                                                             */
+/*    This file is part of ConVEX.                                             */
+/*                                                                             */
+/*    The author is supplying this software for use with the VEX cortex        */
+/*    control system. ConVEX is free software; you can redistribute it         */
+/*    and/or modify it under the terms of the GNU General Public License       */
+/*    as published by the Free Software Foundation; either version 3 of        */
+/*    the License, or (at your option) any later version.                      */
+/*                                                                             */
+/*    ConVEX is distributed in the hope that it will be useful,                */
+/*    but WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            */
+/*    GNU General Public License for more details.                             */
+/*                                                                             */
+/*    You should have received a copy of the GNU General Public License        */
+/*    along with this program.  If not, see <http://www.gnu.org/licenses/>.    */
+/*                                                                             */
+/*    A special exception to the GPL can be applied should you wish to         */
+/*    distribute a combined work that includes ConVEX, without being obliged   */
+/*    to provide the source code for any proprietary components.               */
+/*    See the file exception.txt for full details of how and when the          */
+/*    exception can be applied.                                                */
+/*                                                                             */
+/*    The author can be contacted on the vex forums as jpearman                */
+/*    or electronic mail using jbpearman_at_mac_dot_com                        */
+/*    Mentor for team 8888 RoboLancers, Pasadena CA.                           */
+/*                                                                             */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef __ODOMETRY__
+#define __ODOMETRY__
+
+/*-----------------------------------------------------------------------------*/
+/** @file    odometry.h
+  * @brief   Wheel odometry and pose estimation, macros and prototypes
+*//*---------------------------------------------------------------------------*/
+
+/** @brief Odometry update period in mS
+ */
+#define ODOMETRY_PERIOD_MS          10
+
+/** @brief Odometry thread priority, above the smart motor tasks
+ */
+#define ODOMETRY_THREAD_PRIORITY    (NORMALPRIO + 6)
+
+/** @brief Odometry thread stack, integer only so small
+ */
+#define ODOMETRY_TASK_STACK_SIZE    0x100
+
+/** @brief Angle units (odometry heading) in one revolution
+ */
+#define ODOMETRY_ANGLE_REV          65536L
+
+/** @brief Convert odometry heading to degrees * 10 as used by vexGyroGet
+ */
+#define ODOMETRY_ANGLE_TO_DEG10( a )   ((int32_t)(((int64_t)(a) * 3600) / ODOMETRY_ANGLE_REV))
+
+/** @brief Convert odometry x or y (Q16.16) to whole units
+ */
+#define ODOMETRY_POS_TO_UNITS( p )     ((p) >> 16)
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Drive types                                                         */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kOdometryTank = 0,           ///< left and right wheels, no strafe
+    kOdometryMecanum             ///< four wheels, forward, strafe and turn
+    } tOdometryDrive;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Wheel positions                                                     */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kOdometryLeftFront = 0,
+    kOdometryLeftBack,
+    kOdometryRightFront,
+    kOdometryRightBack,
+
+    kOdometryWheelNum
+    } tOdometryWheel;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Snapshot of the robot pose                                          */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  x and y are Q16.16 in the units chosen by ticks_per_unit, y is to the
+ *  left of the starting heading.  theta is counter clockwise with
+ *  ODOMETRY_ANGLE_REV per revolution and is not wrapped.
+ */
+typedef struct _odometryPose {
+    int32_t      x;              ///< x position, Q16.16 units
+    int32_t      y;              ///< y position, Q16.16 units
+    int32_t      theta;          ///< heading
+    systime_t    time;           ///< system time of the sensor reading
+    uint32_t     seq;            ///< update count
+    } odometryPose;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        OdometryInit( tOdometryDrive drive, float ticks_per_unit, float track );
+void        OdometryWheelSet( tOdometryWheel wheel, tVexSensors port, bool_t reversed );
+void        OdometryGyroSet( bool_t enable, bool_t reversed, float tau );
+void        OdometryRun( void );
+void        OdometryStop( void );
+void        OdometryGetPose( odometryPose *pose );
+void        OdometrySetPose( int32_t x, int32_t y, int32_t theta );
+void        OdometryDebug(vexStream *chp, int argc, char *argv[]);
+
+int16_t     OdometrySin( uint16_t angle );
+int16_t     OdometryCos( uint16_t angle );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __ODOMETRY__
@@ -44,6 +44,7 @@
 /*-----------------------------------------------------------------------------*/
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "ch.h"         // needs for all ChibiOS programs
@@ -51,6 +52,7 @@
 #include "vex.h"
 
 #include "pidlib.h"
+#include "vexflash.h"
 #include "fastmath.c"
 
 /*-----------------------------------------------------------------------------*/
@@ -61,9 +63,20 @@
 // static storage - more portable
 #ifndef PIDLIB_USE_DYNAMIC
 static  pidController   _pidControllers[ MAX_PID ];
+static  pidControllerFx _pidControllersFx[ MAX_PID_FX ];
 #endif
 
 static  int16_t          nextPidControllerPtr = 0;
+static  int16_t          nextPidControllerFxPtr = 0;
+
+// all allocated controllers, used by the executor
+static  pidController   *pidControllers[ MAX_PID ];
+
+// executor state
+static  void           (*pidExecOutput)(int16_t index, int16_t value) = vexMotorSet;
+static  systime_t        pidExecLastRun = 0;
+static  uint32_t         pidExecRuns = 0;
+static  uint32_t         pidExecLate = 0;
 
 static  int16_t          PidDriveLut[PIDLIB_LUT_SIZE];
 
@@ -79,6 +92,19 @@ sgn(float x)
  */
 #define _LinearizeDrive( x )    PidDriveLut[abs(x)] * sgn(x)
 
+/** @brief      Integer version of the LUT access for the fixed point code
+ */
+#define _LinearizeDriveFx( x )  (((x) < 0) ? -PidDriveLut[-(x)] : PidDriveLut[(x)])
+
+/** @brief      Convert DWT cycle count to uS
+ */
+#define _PidCyclesToUs( x )     ((x) / (halGetCounterFrequency() / 1000000))
+
+static  void    _PidControllerSensorRead( pidController *p );
+static  int16_t _PidControllerCalculate( pidController *p );
+static  void    _PidControllerSetGains( pidController *p, float Kp, float Ki, float Kd );
+static  int16_t _PidAutoTuneCalculate( pidController *p, systime_t now );
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Initialize the PID controller                                  */
 /*-----------------------------------------------------------------------------*/
@@ -92,29 +118,17 @@ PidControllerInit( float Kp, float Ki, float Kd, tVexSensors port, int16_t senso
         return(NULL);
 
 #ifndef PIDLIB_USE_DYNAMIC
-    p = (pidController *)&_pidControllers[ nextPidControllerPtr++ ];
+    p = (pidController *)&_pidControllers[ nextPidControllerPtr ];
 #else
     p = chHeapAlloc( NULL, sizeof( pidController ) );
+    if( p == NULL )
+        return(NULL);
 #endif
 
-    // pid constants
-    p->Kp    = Kp;
-    p->Ki    = Ki;
-    p->Kd    = Kd;
+    // pid constants and working variables
+    _PidControllerSetGains( p, Kp, Ki, Kd );
     p->Kbias = 0.0;
 
-    // zero out working variables
-    p->error           = 0;
-    p->last_error      = 0;
-    p->integral        = 0;
-    p->derivative      = 0;
-    p->drive           = 0.0;
-    p->drive_cmd       = 0;
-    if(Ki != 0)
-        p->integral_limit  = (PIDLIB_INTEGRAL_DRIVE_MAX / Ki);
-    else
-        p->integral_limit  = 0;
-
     p->error_threshold = 10;
 
     // sensor port
@@ -131,11 +145,56 @@ PidControllerInit( float Kp, float Ki, float Kd, tVexSensors port, int16_t senso
     else
         p->enabled    = 0;
 
+    // not run by the executor until motors are assigned
+    p->exec            = 0;
+    p->exec_motor[0]   = kVexMotor_None;
+    p->exec_motor[1]   = kVexMotor_None;
+    p->exec_time       = 0;
+    p->exec_time_max   = 0;
+    p->exec_missed     = 0;
+
+    p->tune            = NULL;
+
+    p->setpoint        = NULL;
+    p->setpoint_arg    = NULL;
+    p->feedforward     = 0.0;
+
     PidControllerMakeLut();
 
+    // register, set the pointer first as the executor may already be
+    // running, the lock keeps the compiler from reordering the stores
+    pidControllers[ nextPidControllerPtr ] = p;
+    chSysLock();
+    nextPidControllerPtr++;
+    chSysUnlock();
+
     return(p);
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set pid constants and zero the working variables               */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_PidControllerSetGains( pidController *p, float Kp, float Ki, float Kd )
+{
+    p->Kp    = Kp;
+    p->Ki    = Ki;
+    p->Kd    = Kd;
+
+    // zero out working variables
+    p->error           = 0;
+    p->last_error      = 0;
+    p->integral        = 0;
+    p->derivative      = 0;
+    p->drive           = 0.0;
+    p->drive_cmd       = 0;
+    if(Ki != 0)
+        p->integral_limit  = (PIDLIB_INTEGRAL_DRIVE_MAX / Ki);
+    else
+        p->integral_limit  = 0;
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Initialize the PID controller - includes bias                  */
 /*-----------------------------------------------------------------------------*/
@@ -161,28 +220,57 @@ PidControllerUpdate( pidController *p )
     if( p == NULL )
         return(0);
 
-    if( p->enabled )
+    _PidControllerSensorRead( p );
+
+    return( _PidControllerCalculate( p ) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Read the sensor for a pid controller                           */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_PidControllerSensorRead( pidController *p )
+{
+    // check for sensor port
+    // otherwise externally calculated error
+    if( p->enabled && p->sensor_port >= 0 )
         {
-        // check for sensor port
-        // otherwise externally calculated error
-        if( p->sensor_port >= 0 )
+        // Get raw position value, may be pot or encoder
+        p->sensor_value = vexSensorValueGet( p->sensor_port );
+
+        // A reversed sensor ?
+        if( p->sensor_reverse )
             {
-            // Get raw position value, may be pot or encoder
-            p->sensor_value = vexSensorValueGet( p->sensor_port );
-
-            // A reversed sensor ?
-            if( p->sensor_reverse )
-                {
-                if( vexSensorIsAnalog( p->sensor_port) )
-                    // reverse pot
-                    p->sensor_value = 4095 - p->sensor_value;
-                else
-                    // reverse encoder
-                    p->sensor_value = -p->sensor_value;
-                }
+            if( vexSensorIsAnalog( p->sensor_port) )
+                // reverse pot
+                p->sensor_value = 4095 - p->sensor_value;
+            else
+                // reverse encoder
+                p->sensor_value = -p->sensor_value;
+            }
+        }
+}
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate new drive from the last sensor reading               */
+/*-----------------------------------------------------------------------------*/
+
+static int16_t
+_PidControllerCalculate( pidController *p )
+{
+    if( p->enabled )
+        {
+        // update target, for example from a motion profile
+        if( p->setpoint != NULL && p->tune == NULL )
+            p->setpoint( p, p->setpoint_arg );
+
+        if( p->sensor_port >= 0 )
             p->error = p->target_value - p->sensor_value;
-            }
+
+        // relay test replaces the normal calculation
+        if( p->tune != NULL )
+            return( _PidAutoTuneCalculate( p, chTimeNow() ) );
 
         // force error to 0 if below threshold
         if( fabs(p->error) < p->error_threshold )
@@ -205,7 +293,7 @@ PidControllerUpdate( pidController *p )
         p->last_error = p->error;
 
         // calculate drive - no delta T in this version
-        p->drive = (p->Kp * p->error) + (p->Ki * p->integral) + (p->Kd * p->derivative) + p->Kbias;
+        p->drive = (p->Kp * p->error) + (p->Ki * p->integral) + (p->Kd * p->derivative) + p->Kbias + p->feedforward;
 
         // drive should be in the range +/- 1.0
         if( fabs( p->drive ) > 1.0 )
@@ -264,4 +352,907 @@ PidControllerMakeLut()
         }
 }
 
+/*-----------------------------------------------------------------------------*/
+/*  Batch executor                                                             */
+/*                                                                             */
+/*  Rather than each pid controller having its own task, controllers with      */
+/*  motors assigned are all run from the system task immediately before motor  */
+/*  data is sent to the master processor.  All sensors are read first so they  */
+/*  are sampled at the same instant, then all controllers are calculated and   */
+/*  finally all motors are written.                                            */
+/*-----------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Run all controllers, called from the system task               */
+/*-----------------------------------------------------------------------------*/
+
+static void
+PidControllerExecutor(void)
+{
+    int16_t         i, m;
+    pidController  *p;
+    halrtcnt_t      start, t0, t1;
+    halrtcnt_t      deadline;
+    systime_t       now = chTimeNow();
+
+    // a missed tick means the executor itself was late
+    if( pidExecRuns && ((systime_t)(now - pidExecLastRun) > (systime_t)MS2ST(SYSTEM_TASK_PERIOD_MS + 1)) )
+        pidExecLate++;
+    pidExecLastRun = now;
+    pidExecRuns++;
+
+    deadline = PIDLIB_EXEC_DEADLINE_US * (halGetCounterFrequency() / 1000000);
+    start    = halGetCounterValue();
+
+    // read all sensors
+    for(i=0;i<nextPidControllerPtr;i++)
+        {
+        p = pidControllers[i];
+        if( !p->exec )
+            continue;
+
+        t0 = halGetCounterValue();
+        _PidControllerSensorRead( p );
+        p->exec_time = halGetCounterValue() - t0;
+        }
+
+    // calculate
+    for(i=0;i<nextPidControllerPtr;i++)
+        {
+        p = pidControllers[i];
+        if( !p->exec )
+            continue;
+
+        t0 = halGetCounterValue();
+        _PidControllerCalculate( p );
+        t1 = halGetCounterValue();
+
+        p->exec_time += t1 - t0;
+        if( p->exec_time > p->exec_time_max )
+            p->exec_time_max = p->exec_time;
+        if( (t1 - start) > deadline )
+            p->exec_missed++;
+        }
+
+    // send to motors
+    for(i=0;i<nextPidControllerPtr;i++)
+        {
+        p = pidControllers[i];
+        if( !p->exec )
+            continue;
+
+        for(m=0;m<PIDLIB_EXEC_MOTORS;m++)
+            {
+            if( p->exec_motor[m] == kVexMotor_None )
+                continue;
+            // the motor driver linearizes for the motor type, do not do it twice
+            if( pidExecOutput == vexMotorSet && vexMotorLinearizeGet( p->exec_motor[m] ) )
+                pidExecOutput( p->exec_motor[m], p->drive_raw );
+            else
+                pidExecOutput( p->exec_motor[m], p->drive_cmd );
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Have the executor run a pid controller                         */
+/** @param[in]  p pointer to the pid controller                                */
+/** @param[in]  m1 the first motor to drive                                    */
+/** @param[in]  m2 the second motor to drive or kVexMotor_None                 */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The controller must not also be updated from a user task.  Change
+ *  target_value as needed, the executor does everything else.
+ */
+
+void
+PidControllerExecutorAdd( pidController *p, tVexMotor m1, tVexMotor m2 )
+{
+    if( p == NULL )
+        return;
+
+    p->exec_motor[0] = (m1 < kVexMotorNum) ? m1 : kVexMotor_None;
+    p->exec_motor[1] = (m2 < kVexMotorNum) ? m2 : kVexMotor_None;
+    p->exec_time     = 0;
+    p->exec_time_max = 0;
+    p->exec_missed   = 0;
+
+    // set last, the executor may already be running
+    p->exec          = 1;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop the executor running a pid controller                     */
+/** @param[in]  p pointer to the pid controller                                */
+/*-----------------------------------------------------------------------------*/
+
+void
+PidControllerExecutorRemove( pidController *p )
+{
+    if( p == NULL )
+        return;
+
+    p->exec = 0;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set the function used by the executor to set motors           */
+/** @param[in]  pf the function, NULL restores vexMotorSet                     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  If the smart motor library is running then motors must be set through it
+ *  rather than directly, use a small wrapper around SetMotor.
+ */
+
+void
+PidControllerExecutorOutputSet( void (*pf)(int16_t index, int16_t value) )
+{
+    if( pf == NULL )
+        pidExecOutput = vexMotorSet;
+    else
+        pidExecOutput = pf;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start the executor                                             */
+/*-----------------------------------------------------------------------------*/
+
+void
+PidControllerExecutorStart()
+{
+    pidExecRuns = 0;
+    pidExecLate = 0;
+
+    vexSystemTickCallbackAdd( PidControllerExecutor );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop the executor and any motors it was driving                */
+/*-----------------------------------------------------------------------------*/
+
+void
+PidControllerExecutorStop()
+{
+    int16_t         i, m;
+    pidController  *p;
+
+    vexSystemTickCallbackRemove( PidControllerExecutor );
+
+    for(i=0;i<nextPidControllerPtr;i++)
+        {
+        p = pidControllers[i];
+        if( !p->exec )
+            continue;
+
+        for(m=0;m<PIDLIB_EXEC_MOTORS;m++)
+            {
+            if( p->exec_motor[m] != kVexMotor_None )
+                pidExecOutput( p->exec_motor[m], 0 );
+            }
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Send pid controller status to the debug console                */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+
+void
+PidControllerDebug(vexStream *chp, int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    int16_t         i;
+    pidController  *p;
+
+    vex_chprintf(chp,"executor runs %lu late %lu\r\n", pidExecRuns, pidExecLate );
+    vex_chprintf(chp,"    en ex  m1  m2   target   sensor  cmd  time(us)  max(us) missed\r\n");
+
+    for(i=0;i<nextPidControllerPtr;i++)
+        {
+        p = pidControllers[i];
+        vex_chprintf(chp,"P%d  %2d %2d %3d %3d ", i, p->enabled, p->exec, p->exec_motor[0]+1, p->exec_motor[1]+1 );
+        vex_chprintf(chp,"%8ld %8ld %4d ", p->target_value, p->sensor_value, p->drive_cmd );
+        vex_chprintf(chp,"%9lu %8lu %6lu\r\n", _PidCyclesToUs(p->exec_time), _PidCyclesToUs(p->exec_time_max), p->exec_missed );
+        }
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Fixed point pid controller                                                 */
+/*                                                                             */
+/*  Same algorithm as the float version with constants and drive held as       */
+/*  Q16.16.  Products are formed as 64 bit (a single SMULL on the M3) and all  */
+/*  sums saturate rather than wrap.  Floats are only used during init.         */
+/*-----------------------------------------------------------------------------*/
+
+/** @brief      limit applied to each Q16.16 term so the sum cannot overflow
+ */
+#define PIDLIB_FX_TERM_MAX      ((int64_t)1 << 60)
+
+static inline int32_t
+_PidSat32( int64_t x )
+{
+    if( x > INT32_MAX ) return( INT32_MAX );
+    if( x < INT32_MIN ) return( INT32_MIN );
+    return( (int32_t)x );
+}
+
+static inline int64_t
+_PidSatTerm( int64_t x )
+{
+    if( x >  PIDLIB_FX_TERM_MAX ) return(  PIDLIB_FX_TERM_MAX );
+    if( x < -PIDLIB_FX_TERM_MAX ) return( -PIDLIB_FX_TERM_MAX );
+    return( x );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize the fixed point PID controller                      */
+/*-----------------------------------------------------------------------------*/
+
+pidControllerFx *
+PidControllerFxInit( float Kp, float Ki, float Kd, tVexSensors port, int16_t sensor_reverse )
+{
+    pidControllerFx *p;
+
+    if( nextPidControllerFxPtr == MAX_PID_FX )
+        return(NULL);
+
+#ifndef PIDLIB_USE_DYNAMIC
+    p = (pidControllerFx *)&_pidControllersFx[ nextPidControllerFxPtr ];
+#else
+    p = chHeapAlloc( NULL, sizeof( pidControllerFx ) );
+    if( p == NULL )
+        return(NULL);
+#endif
+    nextPidControllerFxPtr++;
+
+    // pid constants
+    p->Kp    = PIDLIB_FLOAT_TO_FX( Kp );
+    p->Ki    = PIDLIB_FLOAT_TO_FX( Ki );
+    p->Kd    = PIDLIB_FLOAT_TO_FX( Kd );
+    p->Kbias = 0;
+
+    // zero out working variables
+    p->error           = 0;
+    p->last_error      = 0;
+    p->integral        = 0;
+    p->derivative      = 0;
+    p->drive           = 0;
+    p->drive_raw       = 0;
+    p->drive_cmd       = 0;
+    if(Ki != 0)
+        p->integral_limit  = (int32_t)(PIDLIB_INTEGRAL_DRIVE_MAX / Ki);
+    else
+        p->integral_limit  = 0;
+
+    p->error_threshold = 10;
+
+    // sensor port
+    p->sensor_port     = port;
+    p->sensor_reverse  = sensor_reverse;
+    p->sensor_value    = 0;
+
+    p->target_value    = 0;
+
+    p->enabled         = 1;
+
+    PidControllerMakeLut();
+
+    return(p);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Initialize the fixed point PID controller - includes bias      */
+/*-----------------------------------------------------------------------------*/
+
+pidControllerFx *
+PidControllerFxInitWithBias( float Kp, float Ki, float Kd, float Kbias, tVexSensors port, int16_t sensor_reverse )
+{
+    pidControllerFx *p;
+    p = PidControllerFxInit( Kp, Ki, Kd, port, sensor_reverse );
+    if( p != NULL)
+        p->Kbias = PIDLIB_FLOAT_TO_FX( Kbias );
+
+    return(p);
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate new drive for a fixed point controller               */
+/*-----------------------------------------------------------------------------*/
+
+static int16_t
+_PidControllerFxCalculate( pidControllerFx *p )
+{
+    int64_t     drive;
+
+    if( p->enabled )
+        {
+        if( p->sensor_port >= 0 )
+            p->error = _PidSat32( (int64_t)p->target_value - p->sensor_value );
+
+        // force error to 0 if below threshold
+        if( (p->error < p->error_threshold) && (p->error > -p->error_threshold) )
+            p->error = 0;
+
+        // integral accumulation
+        if( p->Ki != 0 )
+            {
+            p->integral = _PidSat32( (int64_t)p->integral + p->error );
+
+            // limit to avoid windup
+            if( p->integral > p->integral_limit )
+                p->integral = p->integral_limit;
+            else
+            if( p->integral < -p->integral_limit )
+                p->integral = -p->integral_limit;
+            }
+        else
+            p->integral = 0;
+
+        // derivative
+        p->derivative = _PidSat32( (int64_t)p->error - p->last_error );
+        p->last_error = p->error;
+
+        // calculate drive, result is Q16.16
+        drive = _PidSatTerm( (int64_t)p->Kp * p->error      ) +
+                _PidSatTerm( (int64_t)p->Ki * p->integral   ) +
+                _PidSatTerm( (int64_t)p->Kd * p->derivative ) +
+                p->Kbias;
+
+        // drive should be in the range +/- 1.0
+        if( drive > PIDLIB_FX_ONE )
+            drive = PIDLIB_FX_ONE;
+        else
+        if( drive < -PIDLIB_FX_ONE )
+            drive = -PIDLIB_FX_ONE;
+        p->drive = (int32_t)drive;
+
+        // final motor output, truncate towards zero as the float version does
+        p->drive_raw = (p->drive * 127) / PIDLIB_FX_ONE;
+        }
+    else
+        {
+        // Disabled - all 0
+        p->error      = 0;
+        p->last_error = 0;
+        p->integral   = 0;
+        p->derivative = 0;
+        p->drive      = 0;
+        p->drive_raw  = 0;
+        }
+
+    // linearize - be careful this is a macro
+    p->drive_cmd = _LinearizeDriveFx( p->drive_raw );
+
+    return( p->drive_cmd );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Update the fixed point pid process variables                   */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+PidControllerFxUpdate( pidControllerFx *p )
+{
+    if( p == NULL )
+        return(0);
+
+    // check for sensor port
+    // otherwise externally calculated error
+    if( p->enabled && p->sensor_port >= 0 )
+        {
+        // Get raw position value, may be pot or encoder
+        p->sensor_value = vexSensorValueGet( p->sensor_port );
+
+        // A reversed sensor ?
+        if( p->sensor_reverse )
+            {
+            if( vexSensorIsAnalog( p->sensor_port) )
+                p->sensor_value = 4095 - p->sensor_value;
+            else
+                p->sensor_value = -p->sensor_value;
+            }
+        }
+
+    return( _PidControllerFxCalculate( p ) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Compare the float and fixed point controllers                  */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Runs both controllers over the same synthetic sensor sweep and reports
+ *  cycles per update and the largest difference in drive_cmd.  Minimum
+ *  cycles are shown as they are not inflated by preemption.  Rounding of the
+ *  constants to Q16.16 can move drive_raw by one count, which the steep end
+ *  of the LUT turns into a few counts of drive_cmd.
+ *  Usage: pidbench [iterations]
+ */
+
+void
+PidControllerBench(vexStream *chp, int argc, char *argv[])
+{
+    pidController    pf;
+    pidControllerFx  px;
+    int32_t          n, i;
+    int32_t          sensor;
+    int16_t          diff, diff_max = 0, raw_max = 0;
+    int32_t          mismatch = 0;
+    halrtcnt_t       t0, t;
+    halrtcnt_t       f_min = 0xFFFFFFFF, x_min = 0xFFFFFFFF;
+    uint32_t         f_total = 0, x_total = 0;
+
+    n = 1000;
+    if( argc > 0 )
+        n = atoi( argv[0] );
+    if( n <= 0 )
+        n = 1000;
+
+    PidControllerMakeLut();
+
+    memset( &pf, 0, sizeof(pf) );
+    memset( &px, 0, sizeof(px) );
+
+    // float controller, not registered and reads no sensor
+    pf.enabled         = 1;
+    pf.Kp              = 0.02;
+    pf.Ki              = 0.001;
+    pf.Kd              = 0.05;
+    pf.Kbias           = 0.0;
+    pf.error           = 0;
+    pf.last_error      = 0;
+    pf.integral        = 0;
+    pf.integral_limit  = PIDLIB_INTEGRAL_DRIVE_MAX / pf.Ki;
+    pf.derivative      = 0;
+    pf.error_threshold = 10;
+    pf.sensor_port     = kVexSensorAnalog_1;
+    pf.target_value    = 2048;
+
+    // matching fixed point controller
+    px.enabled         = 1;
+    px.Kp              = PIDLIB_FLOAT_TO_FX( 0.02 );
+    px.Ki              = PIDLIB_FLOAT_TO_FX( 0.001 );
+    px.Kd              = PIDLIB_FLOAT_TO_FX( 0.05 );
+    px.Kbias           = 0;
+    px.error           = 0;
+    px.last_error      = 0;
+    px.integral        = 0;
+    px.integral_limit  = (int32_t)(PIDLIB_INTEGRAL_DRIVE_MAX / 0.001);
+    px.derivative      = 0;
+    px.error_threshold = 10;
+    px.sensor_port     = kVexSensorAnalog_1;
+    px.target_value    = 2048;
+
+    for(i=0;i<n;i++)
+        {
+        // triangle sweep across the full pot range
+        sensor = (i * 37) % 8190;
+        if( sensor > 4095 )
+            sensor = 8190 - sensor;
+
+        pf.sensor_value = sensor;
+        t0 = halGetCounterValue();
+        _PidControllerCalculate( &pf );
+        t = halGetCounterValue() - t0;
+        f_total += t;
+        if( t < f_min ) f_min = t;
+
+        px.sensor_value = sensor;
+        t0 = halGetCounterValue();
+        _PidControllerFxCalculate( &px );
+        t = halGetCounterValue() - t0;
+        x_total += t;
+        if( t < x_min ) x_min = t;
+
+        diff = abs( pf.drive_raw - px.drive_raw );
+        if( diff > raw_max )
+            raw_max = diff;
+
+        diff = abs( pf.drive_cmd - px.drive_cmd );
+        if( diff != 0 )
+            mismatch++;
+        if( diff > diff_max )
+            diff_max = diff;
+        }
+
+    vex_chprintf(chp,"iterations %ld\r\n", n );
+    vex_chprintf(chp,"float  min %5lu avg %5lu cycles\r\n", f_min, f_total / n );
+    vex_chprintf(chp,"fixed  min %5lu avg %5lu cycles\r\n", x_min, x_total / n );
+    vex_chprintf(chp,"drive_cmd mismatch %ld max diff %d (drive_raw %d)\r\n", mismatch, diff_max, raw_max );
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Relay auto tuner                                                           */
+/*                                                                             */
+/*  Astrom-Hagglund relay test.  The motor is driven with +/- relay around     */
+/*  the target, with some hysteresis, which causes a limit cycle at the        */
+/*  ultimate period Tu.  From the oscillation amplitude a the ultimate gain    */
+/*  is Ku = 4d / (pi * sqrt(a^2 - h^2)).  The controller has no delta T so     */
+/*  Ti and Td are converted using the measured update interval.                */
+/*-----------------------------------------------------------------------------*/
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+// only one controller can be tuned at a time
+static  pidAutoTune     pidTuner;
+static  pidController  *pidTunerController = NULL;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Reset the tuner working data                                   */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_PidAutoTuneInit( pidAutoTune *t, float relay, float hysteresis, tPidTuneRule rule )
+{
+    t->state         = kPidTuneRunning;
+    t->rule          = rule;
+    t->relay         = fabs( relay );
+    t->hysteresis    = fabs( hysteresis );
+    t->output        = 0;
+    t->cycles        = 0;
+    t->measured      = 0;
+    t->updates       = 0;
+    t->period_sum    = 0;
+    t->amplitude_sum = 0;
+    t->Ku            = 0;
+    t->Tu            = 0;
+    t->dt            = 0;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate gains from the relay test results                    */
+/*-----------------------------------------------------------------------------*/
+
+static void
+_PidAutoTuneFinish( pidController *p, pidAutoTune *t, systime_t now )
+{
+    float   a, Kp, Ti, Td;
+
+    // start_time is the first update so there is one interval less
+    if( t->updates < 2 )
+        {
+        t->state = kPidTuneFailed;
+        return;
+        }
+
+    a     = t->amplitude_sum / t->measured;
+    t->Tu = ((float)t->period_sum / t->measured) / CH_FREQUENCY;
+    t->dt = ((float)(systime_t)(now - t->start_time) / (t->updates - 1)) / CH_FREQUENCY;
+
+    // oscillation must be larger than the hysteresis to be meaningful
+    if( a <= t->hysteresis || t->dt <= 0 )
+        {
+        t->state = kPidTuneFailed;
+        return;
+        }
+
+    t->Ku = (4.0 * t->relay) / (M_PI * sqrtf( a * a - t->hysteresis * t->hysteresis ));
+
+    if( t->rule == kPidTuneTyreusLuyben )
+        {
+        Kp = t->Ku / 2.2;
+        Ti = t->Tu * 2.2;
+        Td = t->Tu / 6.3;
+        }
+    else
+        {
+        Kp = t->Ku * 0.6;
+        Ti = t->Tu / 2.0;
+        Td = t->Tu / 8.0;
+        }
+
+    // no delta T in the controller, scale by the update interval
+    _PidControllerSetGains( p, Kp, Kp * t->dt / Ti, Kp * Td / t->dt );
+
+    t->state = kPidTuneDone;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      One update of the relay test, error must already be set       */
+/*-----------------------------------------------------------------------------*/
 
+static int16_t
+_PidAutoTuneCalculate( pidController *p, systime_t now )
+{
+    pidAutoTune *t = p->tune;
+
+    if( t->state != kPidTuneRunning )
+        {
+        p->tune = NULL;
+        return( _PidControllerCalculate( p ) );
+        }
+
+    // first call
+    if( t->updates++ == 0 )
+        {
+        t->start_time  = now;
+        t->last_switch = now;
+        t->peak_max    = p->sensor_value;
+        t->peak_min    = p->sensor_value;
+        t->output      = (p->error >= 0) ? t->relay : -t->relay;
+        }
+
+    if( p->sensor_value > t->peak_max ) t->peak_max = p->sensor_value;
+    if( p->sensor_value < t->peak_min ) t->peak_min = p->sensor_value;
+
+    // relay with hysteresis
+    if( t->output < 0 && p->error > t->hysteresis )
+        {
+        t->output = t->relay;
+
+        // one complete oscillation
+        if( ++t->cycles > PIDLIB_TUNE_SETTLE_CYCLES )
+            {
+            t->period_sum    += (systime_t)(now - t->last_switch);
+            t->amplitude_sum += (t->peak_max - t->peak_min) / 2.0;
+            t->measured++;
+            }
+
+        t->last_switch = now;
+        t->peak_max    = p->sensor_value;
+        t->peak_min    = p->sensor_value;
+        }
+    else
+    if( t->output > 0 && p->error < -t->hysteresis )
+        t->output = -t->relay;
+
+    if( t->measured >= PIDLIB_TUNE_CYCLES )
+        {
+        _PidAutoTuneFinish( p, t, now );
+        p->tune = NULL;
+        t->output = 0;
+        }
+    else
+    if( (systime_t)(now - t->start_time) > (systime_t)MS2ST(PIDLIB_TUNE_TIMEOUT_MS) )
+        {
+        t->state  = kPidTuneFailed;
+        p->tune   = NULL;
+        t->output = 0;
+        }
+
+    // relay output around any bias
+    p->drive = p->Kbias + t->output;
+    if( fabs( p->drive ) > 1.0 )
+        p->drive = sgn(p->drive);
+
+    p->drive_raw = p->drive * 127.0;
+    p->drive_cmd = _LinearizeDrive( p->drive_raw );
+
+    return( p->drive_cmd );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Start a relay auto tune on a pid controller                    */
+/** @param[in]  p pointer to the pid controller                                */
+/** @param[in]  relay relay amplitude as a fraction of full drive              */
+/** @param[in]  hysteresis relay hysteresis in sensor units                    */
+/** @param[in]  rule rule used to calculate the gains                          */
+/** @returns    pointer to the tuner status or NULL if a tune is running       */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Set target_value before starting, the mechanism will oscillate around it
+ *  so choose a target with room either side.  Keep calling
+ *  PidControllerUpdate (or leave the controller with the executor) until the
+ *  state is kPidTuneDone or kPidTuneFailed, the new gains are then already
+ *  in the controller.
+ */
+
+pidAutoTune *
+PidControllerAutoTuneStart( pidController *p, float relay, float hysteresis, tPidTuneRule rule )
+{
+    if( p == NULL )
+        return(NULL);
+
+    if( pidTunerController != NULL && pidTunerController->tune != NULL )
+        return(NULL);
+
+    _PidAutoTuneInit( &pidTuner, relay, hysteresis, rule );
+    pidTunerController = p;
+    p->tune = &pidTuner;
+
+    return( &pidTuner );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Stop a relay auto tune, gains are not changed                  */
+/** @param[in]  p pointer to the pid controller                                */
+/*-----------------------------------------------------------------------------*/
+
+void
+PidControllerAutoTuneAbort( pidController *p )
+{
+    if( p == NULL || p->tune == NULL )
+        return;
+
+    p->tune->state = kPidTuneFailed;
+    p->tune = NULL;
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Gain storage in the flash user parameters                                  */
+/*                                                                             */
+/*  The user parameter block is 32 bytes, a two byte marker and a byte with    */
+/*  a valid flag for each slot followed by Kp, Ki and Kd as floats per slot.   */
+/*  This uses the whole block, don't mix with other user parameters.          */
+/*-----------------------------------------------------------------------------*/
+
+#define PIDLIB_GAIN_MARKER_0    'P'
+#define PIDLIB_GAIN_MARKER_1    'G'
+#define PIDLIB_GAIN_OFFSET      4
+#define PIDLIB_GAIN_SIZE        (3 * sizeof(float))
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Save pid gains to flash                                        */
+/** @param[in]  p pointer to the pid controller                                */
+/** @param[in]  slot storage slot, 0 to PIDLIB_GAIN_SLOTS-1                    */
+/** @returns    FLASH_SUCCESS or a flash error code                            */
+/*-----------------------------------------------------------------------------*/
+
+int16_t
+PidControllerGainsSave( pidController *p, int16_t slot )
+{
+    user_param  *u;
+    float        gains[3];
+
+    if( p == NULL || slot < 0 || slot >= PIDLIB_GAIN_SLOTS )
+        return( FLASH_ERROR );
+
+    // read, modify, write so the other slot is kept
+    u = vexFlashUserParamRead();
+    if( u->data[0] != PIDLIB_GAIN_MARKER_0 || u->data[1] != PIDLIB_GAIN_MARKER_1 )
+        {
+        memset( u->data, 0, sizeof(u->data) );
+        u->data[0] = PIDLIB_GAIN_MARKER_0;
+        u->data[1] = PIDLIB_GAIN_MARKER_1;
+        }
+
+    gains[0] = p->Kp;
+    gains[1] = p->Ki;
+    gains[2] = p->Kd;
+    memcpy( &u->data[ PIDLIB_GAIN_OFFSET + slot * PIDLIB_GAIN_SIZE ], gains, PIDLIB_GAIN_SIZE );
+    u->data[2] |= (1 << slot);
+
+    return( vexFlashUserParamWrite( u ) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Load pid gains from flash                                      */
+/** @param[in]  p pointer to the pid controller                                */
+/** @param[in]  slot storage slot, 0 to PIDLIB_GAIN_SLOTS-1                    */
+/** @returns    TRUE if gains were loaded                                      */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+PidControllerGainsLoad( pidController *p, int16_t slot )
+{
+    user_param  *u;
+    float        gains[3];
+
+    if( p == NULL || slot < 0 || slot >= PIDLIB_GAIN_SLOTS )
+        return( FALSE );
+
+    u = vexFlashUserParamRead();
+    if( u->data[0] != PIDLIB_GAIN_MARKER_0 || u->data[1] != PIDLIB_GAIN_MARKER_1 )
+        return( FALSE );
+    if( (u->data[2] & (1 << slot)) == 0 )
+        return( FALSE );
+
+    memcpy( gains, &u->data[ PIDLIB_GAIN_OFFSET + slot * PIDLIB_GAIN_SIZE ], PIDLIB_GAIN_SIZE );
+    _PidControllerSetGains( p, gains[0], gains[1], gains[2] );
+
+    return( TRUE );
+}
+
+/*-----------------------------------------------------------------------------*/
+/*  Simulated plant, a motor driving an arm, used to check the tuner           */
+/*  without any hardware.  Velocity follows drive with a first order lag,      */
+/*  the command reaches the motor one update late as it would over the spi.   */
+/*-----------------------------------------------------------------------------*/
+
+#define PIDLIB_SIM_DT_MS        20      // update interval
+#define PIDLIB_SIM_GAIN         800.0   // counts per second at full drive
+#define PIDLIB_SIM_TAU          0.15    // motor time constant in seconds
+#define PIDLIB_SIM_TARGET       500
+
+typedef struct {
+    float   x;      // position in counts
+    float   v;      // velocity in counts per second
+    int16_t cmd;    // command waiting to be sent
+    } pidSimPlant;
+
+static void
+_PidSimStep( pidSimPlant *s, int16_t cmd )
+{
+    float dt = PIDLIB_SIM_DT_MS / 1000.0;
+    float u  = s->cmd / 127.0;
+
+    s->v  += (PIDLIB_SIM_GAIN * u - s->v) * dt / PIDLIB_SIM_TAU;
+    s->x  += s->v * dt;
+    s->cmd = cmd;
+}
+
+static void
+_PidControllerTuneSimulate( vexStream *chp, tPidTuneRule rule )
+{
+    pidController   p;
+    pidAutoTune     t;
+    pidSimPlant     s = { 0, 0, 0 };
+    systime_t       now = 0;
+    int16_t         i;
+    int32_t         peak = 0;
+
+    memset( &p, 0, sizeof(p) );
+    p.enabled         = 1;
+    p.error_threshold = 10;
+    p.target_value    = PIDLIB_SIM_TARGET;
+    PidControllerMakeLut();
+
+    _PidAutoTuneInit( &t, 0.5, 10, rule );
+    p.tune = &t;
+
+    // relay test
+    for(i=0;i<(PIDLIB_TUNE_TIMEOUT_MS/PIDLIB_SIM_DT_MS) && p.tune != NULL;i++)
+        {
+        p.sensor_value = s.x;
+        p.error = p.target_value - p.sensor_value;
+        _PidSimStep( &s, _PidAutoTuneCalculate( &p, now ) );
+        now += MS2ST(PIDLIB_SIM_DT_MS);
+        }
+
+    if( t.state != kPidTuneDone )
+        {
+        vex_chprintf(chp,"sim tune failed\r\n");
+        return;
+        }
+
+    vex_chprintf(chp,"Ku %.4f Tu %.3f dt %.3f\r\n", t.Ku, t.Tu, t.dt );
+    vex_chprintf(chp,"Kp %.4f Ki %.5f Kd %.4f\r\n", p.Kp, p.Ki, p.Kd );
+
+    // closed loop step from rest using the new gains
+    s.x = 0; s.v = 0; s.cmd = 0;
+    for(i=0;i<(4000/PIDLIB_SIM_DT_MS);i++)
+        {
+        p.sensor_value = s.x;
+        _PidSimStep( &s, _PidControllerCalculate( &p ) );
+        if( p.sensor_value > peak )
+            peak = p.sensor_value;
+        }
+
+    vex_chprintf(chp,"step %d overshoot %ld final error %ld\r\n", PIDLIB_SIM_TARGET, peak - PIDLIB_SIM_TARGET, (int32_t)PIDLIB_SIM_TARGET - p.sensor_value );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Auto tune status, or test the tuner with a simulated plant     */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Usage: pidtune [sim [tl]]
+ */
+
+void
+PidControllerTuneDebug(vexStream *chp, int argc, char *argv[])
+{
+    if( argc > 0 && strcmp( argv[0], "sim" ) == 0 )
+        {
+        if( argc > 1 && strcmp( argv[1], "tl" ) == 0 )
+            _PidControllerTuneSimulate( chp, kPidTuneTyreusLuyben );
+        else
+            _PidControllerTuneSimulate( chp, kPidTuneZieglerNichols );
+        return;
+        }
+
+    vex_chprintf(chp,"state %d cycles %d measured %d updates %lu\r\n", pidTuner.state, pidTuner.cycles, pidTuner.measured, pidTuner.updates );
+    vex_chprintf(chp,"Ku %.4f Tu %.3f dt %.3f\r\n", pidTuner.Ku, pidTuner.Tu, pidTuner.dt );
+    if( pidTunerController != NULL )
+        vex_chprintf(chp,"Kp %.4f Ki %.5f Kd %.4f\r\n", pidTunerController->Kp, pidTunerController->Ki, pidTunerController->Kd );
+}
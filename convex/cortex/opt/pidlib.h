@@ -59,11 +59,17 @@
  */
 #define PIDLIB_USE_DYNAMIC      1
 
+/** @brief Number of motors one controller can drive from the executor
+ */
+#define PIDLIB_EXEC_MOTORS      2
+
+struct _pidAutoTune;
+
 /*-----------------------------------------------------------------------------*/
 /** @brief Structure to hold all data for one instance of a PID controller     */
 /*-----------------------------------------------------------------------------*/
 /** @note
- *  Currently at 64 bytes memory usage
+ *  Currently at 100 bytes memory usage
  */
 typedef struct _pidController {
     // Turn on or off the control loop
@@ -94,14 +100,122 @@ typedef struct _pidController {
     int32_t      sensor_value;   ///< current value of the position sensor
 
     int32_t      target_value;   ///< the target value
+
+    // batch executor
+    int16_t      exec;           ///< flag indicating the executor runs this controller
+    int16_t      exec_motor[PIDLIB_EXEC_MOTORS]; ///< motors driven by the executor
+    uint32_t     exec_time;      ///< cycles used by the last update
+    uint32_t     exec_time_max;  ///< maximum cycles used by an update
+    uint32_t     exec_missed;    ///< updates that completed after the deadline
+
+    // auto tune
+    struct _pidAutoTune *tune;   ///< relay auto tuner, NULL when not tuning
+
+    // setpoint generator, called before each calculation
+    void       (*setpoint)( struct _pidController *p, void *arg ); ///< updates target and feedforward
+    void        *setpoint_arg;   ///< argument passed to setpoint
+    float        feedforward;    ///< added to drive, in the range +/- 1.0
     } pidController;
 
+/*-----------------------------------------------------------------------------*/
+/** @brief Rules used to calculate gains from the relay test                   */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kPidTuneZieglerNichols = 0,  ///< classic, fast with some overshoot
+    kPidTuneTyreusLuyben         ///< more conservative, less overshoot
+    } tPidTuneRule;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief State of the relay auto tuner                                       */
+/*-----------------------------------------------------------------------------*/
+typedef enum {
+    kPidTuneIdle = 0,
+    kPidTuneRunning,
+    kPidTuneDone,
+    kPidTuneFailed
+    } tPidTuneState;
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Working data for the relay (Astrom-Hagglund) auto tuner             */
+/*-----------------------------------------------------------------------------*/
+typedef struct _pidAutoTune {
+    tPidTuneState   state;       ///< current state
+    tPidTuneRule    rule;        ///< rule used to calculate the gains
+
+    float           relay;       ///< relay amplitude, fraction of full drive
+    float           hysteresis;  ///< relay hysteresis in sensor units
+    float           output;      ///< current relay output
+
+    int32_t         peak_max;    ///< maximum sensor value this cycle
+    int32_t         peak_min;    ///< minimum sensor value this cycle
+    int16_t         cycles;      ///< number of complete oscillations
+    int16_t         measured;    ///< number of oscillations measured
+
+    systime_t       start_time;  ///< time the test started
+    systime_t       last_switch; ///< time of the last positive relay switch
+    uint32_t        updates;     ///< number of updates since the start
+    uint32_t        period_sum;  ///< sum of measured periods in system ticks
+    float           amplitude_sum; ///< sum of measured amplitudes
+
+    // results
+    float           Ku;          ///< ultimate gain
+    float           Tu;          ///< ultimate period in seconds
+    float           dt;          ///< average update interval in seconds
+    } pidAutoTune;
+
+
+/*-----------------------------------------------------------------------------*/
+/** @brief Fixed point version of the PID controller                           */
+/*-----------------------------------------------------------------------------*/
+/** @note
+ *  Constants and drive are Q16.16, 1.0 is 65536.  Error and integral are in
+ *  sensor units as for the float version.  The Cortex-M3 has no FPU so this
+ *  avoids all soft float calls in the update.
+ */
+typedef struct _pidControllerFx {
+    int16_t      enabled;        ///< enable or diable pid calculations
+    int16_t      res1;           ///< word alignment of Kp
+
+    int32_t      Kp;             ///< proportional constant Q16.16
+    int32_t      Ki;             ///< integral constant Q16.16
+    int32_t      Kd;             ///< derivative constant Q16.16
+    int32_t      Kbias;          ///< bias constant Q16.16
+
+    int32_t      error;          ///< error between actual pisition and target
+    int32_t      last_error;     ///< error last time update called
+    int32_t      integral;       ///< integrated error
+    int32_t      integral_limit; ///< limit for integrated error
+    int32_t      derivative;     ///< change in error from last time
+    int32_t      error_threshold;///< threshold below which error is ignored
+
+    int32_t      drive;          ///< calculated motor drive Q16.16 in range +/- 1.0
+    int16_t      drive_raw;      ///< motor drive in the range +/- 127
+    int16_t      drive_cmd;      ///< linearized motor drive in the range +/- 127
+
+    tVexSensors  sensor_port;    ///< digital or analog port with the position sensor
+    int16_t      sensor_reverse; ///< flag indicating the sensor values should be reversed
+    int32_t      sensor_value;   ///< current value of the position sensor
+
+    int32_t      target_value;   ///< the target value
+    } pidControllerFx;
+
+/** @brief Q16.16 representation of 1.0
+ */
+#define PIDLIB_FX_ONE               65536L
+/** @brief Convert a float constant to Q16.16, only used during init
+ */
+#define PIDLIB_FLOAT_TO_FX( x )     ((int32_t)((x) * (float)PIDLIB_FX_ONE + (((x) < 0) ? -0.5 : 0.5)))
 
 /*-----------------------------------------------------------------------------*/
 /** @brief Allow 4 pid controllers                                             */
 /*-----------------------------------------------------------------------------*/
 #define MAX_PID                     4
 
+/*-----------------------------------------------------------------------------*/
+/** @brief Allow 10 fixed point pid controllers                                */
+/*-----------------------------------------------------------------------------*/
+#define MAX_PID_FX                 10
+
 // lookup table to linearize control
 
 /** @brief size of linearizing table
@@ -119,6 +233,24 @@ typedef struct _pidController {
  */
 #define PIDLIB_INTEGRAL_DRIVE_MAX   0.25
 
+/** @brief Time allowed for the executor to update all controllers in uS
+ */
+#define PIDLIB_EXEC_DEADLINE_US   1000
+
+/** @brief Oscillations ignored while the relay test settles
+ */
+#define PIDLIB_TUNE_SETTLE_CYCLES   2
+/** @brief Oscillations averaged by the relay test
+ */
+#define PIDLIB_TUNE_CYCLES          4
+/** @brief Relay test is abandoned if not complete by this time
+ */
+#define PIDLIB_TUNE_TIMEOUT_MS  30000
+
+/** @brief Number of pid gain sets that fit in the flash user parameters
+ */
+#define PIDLIB_GAIN_SLOTS           2
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -128,6 +260,24 @@ pidController *PidControllerInitWithBias( float Kp, float Ki, float Kd, float Kb
 int16_t        PidControllerUpdate( pidController *p );
 void           PidControllerMakeLut(void);
 
+void           PidControllerExecutorAdd( pidController *p, tVexMotor m1, tVexMotor m2 );
+void           PidControllerExecutorRemove( pidController *p );
+void           PidControllerExecutorOutputSet( void (*pf)(int16_t index, int16_t value) );
+void           PidControllerExecutorStart( void );
+void           PidControllerExecutorStop( void );
+void           PidControllerDebug(vexStream *chp, int argc, char *argv[]);
+
+pidControllerFx *PidControllerFxInit( float Kp, float Ki, float Kd, tVexSensors port, int16_t sensor_reverse );
+pidControllerFx *PidControllerFxInitWithBias( float Kp, float Ki, float Kd, float Kbias, tVexSensors port, int16_t sensor_reverse );
+int16_t        PidControllerFxUpdate( pidControllerFx *p );
+void           PidControllerBench(vexStream *chp, int argc, char *argv[]);
+
+pidAutoTune   *PidControllerAutoTuneStart( pidController *p, float relay, float hysteresis, tPidTuneRule rule );
+void           PidControllerAutoTuneAbort( pidController *p );
+int16_t        PidControllerGainsSave( pidController *p, int16_t slot );
+bool_t         PidControllerGainsLoad( pidController *p, int16_t slot );
+void           PidControllerTuneDebug(vexStream *chp, int argc, char *argv[]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,6 +66,24 @@
  */
 #define TC_THREAD_STACK 584
 
+/*-----------------------------------------------------------------------------*/
+/** @brief   Number of task working areas reserved at build time
+ *  Each one is a little over 700 bytes of static RAM, tasks started once the
+ *  pool is empty come from the heap (see RC_TASK_POOL_FALLBACK).
+ */
+#if !defined(RC_TASK_POOL_SIZE)
+#define RC_TASK_POOL_SIZE   4
+#endif
+
+/*-----------------------------------------------------------------------------*/
+/** @brief   Start tasks from the heap when the pool is empty
+ *  Set to FALSE to make StartTask fail instead, the heap is then never used
+ *  and cannot fragment.
+ */
+#if !defined(RC_TASK_POOL_FALLBACK)
+#define RC_TASK_POOL_FALLBACK   TRUE
+#endif
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Structure that correlates a function name with a thread
  */
@@ -76,6 +94,51 @@ typedef struct _rcTask {
 
 static  rcTask  rcTasks[RC_TASKS];
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Fixed size working areas for the tasks
+ *  The kernel returns a working area to the pool when the thread has exited
+ *  and been waited for, allocation and free are both O(1).
+ */
+static  stkalign_t  rcTaskWorkingAreas[RC_TASK_POOL_SIZE][THD_WA_SIZE(TC_THREAD_STACK) / sizeof(stkalign_t)];
+static  MEMORYPOOL_DECL(rcTaskPool, THD_WA_SIZE(TC_THREAD_STACK), NULL);
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Task start statistics
+ */
+static  struct {
+    uint32_t    pool;           ///< tasks started from the pool
+    uint32_t    heap;           ///< tasks started from the heap, pool was empty
+    uint32_t    failed;         ///< tasks that could not be started
+    } rcTaskStats;
+
+/*-----------------------------------------------------------------------------*/
+/*  Load the working areas into the pool, done once before the first task      */
+/*  starts.  Locked so two threads starting tasks together cannot both load    */
+/*  the pool.                                                                  */
+/*-----------------------------------------------------------------------------*/
+static void
+_rcTaskPoolInit(void)
+{
+    static  bool_t  init = TRUE;
+    int16_t     i;
+
+    chSysLock();
+    if(init)
+        {
+        for(i=0;i<RC_TASKS;i++)
+            {
+            rcTasks[i].pf = NULL;
+            rcTasks[i].tp = NULL;
+            }
+        // working areas into the pool, chPoolLoadArray takes the lock itself
+        for(i=0;i<RC_TASK_POOL_SIZE;i++)
+            chPoolFreeI( &rcTaskPool, rcTaskWorkingAreas[i] );
+        // not next time
+        init = FALSE;
+        }
+    chSysUnlock();
+}
+
 /*-----------------------------------------------------------------------------*/
 /*  All robotc threads now start here, this then calls the user supplied       */
 /*-----------------------------------------------------------------------------*/
@@ -105,21 +168,11 @@ vexRobotcTask(void *arg)
 Thread *
 StartTaskWithPriority(tfunc_t pf, tprio_t priority, ... )
 {
-    static  bool_t  init = TRUE;
     int16_t     i;
     bool_t      memfree = FALSE;
 
     // First time initialization
-    if(init)
-        {
-        for(i=0;i<RC_TASKS;i++)
-            {
-            rcTasks[i].pf = NULL;
-            rcTasks[i].tp = NULL;
-            }
-        // not next time
-        init = FALSE;
-        }
+    _rcTaskPoolInit();
 
     // Check to see of this function is already in the robotc task list
     for(i=0;i<RC_TASKS;i++)
@@ -141,10 +194,30 @@ StartTaskWithPriority(tfunc_t pf, tprio_t priority, ... )
         return(NULL);
 
     Thread *tp;
-    tp = chThdCreateFromHeap(NULL, THD_WA_SIZE(TC_THREAD_STACK), priority, vexRobotcTask, (void *)pf );
+    tp = chThdCreateFromMemoryPool( &rcTaskPool, priority, vexRobotcTask, (void *)pf );
 
-    // tp will be NULL if memory is exhausted
+    // tp will be NULL if the pool is empty
     if( tp != NULL )
+        {
+        chSysLock();
+        rcTaskStats.pool++;
+        chSysUnlock();
+        }
+#if RC_TASK_POOL_FALLBACK
+    else
+    if( (tp = chThdCreateFromHeap(NULL, THD_WA_SIZE(TC_THREAD_STACK), priority, vexRobotcTask, (void *)pf )) != NULL )
+        {
+        chSysLock();
+        rcTaskStats.heap++;
+        chSysUnlock();
+        }
+#endif
+
+    // tp will be NULL if memory is exhausted
+    chSysLock();
+    if( tp == NULL )
+        rcTaskStats.failed++;
+    else
         {
         // Save association of thread and callback
         for(i=0;i<RC_TASKS;i++)
@@ -157,6 +230,7 @@ StartTaskWithPriority(tfunc_t pf, tprio_t priority, ... )
                 }
             }
         }
+    chSysUnlock();
 
     return(tp);
 }
@@ -217,3 +291,35 @@ CleanupTask( Thread *tp )
             }
         }
 }
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Show ROBOTC task status                                        */
+/** @param[in]  chp     A pointer to a vexStream object                        */
+/** @param[in]  argc    The number of command line arguments                   */
+/** @param[in]  argv    An array of pointers to the command line args          */
+/*-----------------------------------------------------------------------------*/
+
+void
+RobotcTaskDebug(vexStream *chp, int argc, char *argv[])
+{
+    int16_t     i, nfree = 0;
+    struct pool_header *ph;
+
+    (void)argc;
+    (void)argv;
+
+    // count free working areas
+    chSysLock();
+    for( ph = rcTaskPool.mp_next; ph != NULL; ph = ph->ph_next )
+        nfree++;
+    chSysUnlock();
+
+    vex_chprintf(chp, "pool %d of %d free, %d bytes each\r\n", nfree, RC_TASK_POOL_SIZE, THD_WA_SIZE(TC_THREAD_STACK) );
+    vex_chprintf(chp, "started pool %d heap %d failed %d\r\n", rcTaskStats.pool, rcTaskStats.heap, rcTaskStats.failed );
+
+    for(i=0;i<RC_TASKS;i++)
+        {
+        if( rcTasks[i].tp != NULL )
+            vex_chprintf(chp, "%2d: %.8X %.8X\r\n", i, rcTasks[i].pf, rcTasks[i].tp );
+        }
+}
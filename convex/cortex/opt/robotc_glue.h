@@ -70,6 +70,7 @@ extern "C" {
 
 Thread         *StartTaskWithPriority(tfunc_t pf, tprio_t priority, ... );
 void            StopTask(tfunc_t pf);
+void            RobotcTaskDebug(vexStream *chp, int argc, char *argv[]);
 
 #ifdef __cplusplus
 }
@@ -136,6 +136,13 @@ static short    PtcLimitEnabled = FALSE;
 // based on preset threshold - defaults to on
 static short    CurrentLimitEnabled = FALSE;
 
+// flag to hold global status to enable or disable sharing of the total
+// available current between motors by priority - defaults to off
+static short    BudgetEnabled = FALSE;
+
+// total current available last time the budget was calculated
+static float    BudgetCurrent = 0;
+
 static inline float
 sgn(float x)
 {
@@ -258,6 +265,33 @@ SmartMotorGetLimitCmd( tVexMotor index )
     return( sMotors[ index ].limit_cmd );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get Motor predicted time to PTC trip                           */
+/** @param[in]  index The motor index                                          */
+/** @returns    Seconds until the motor or its bank trips at present current   */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Returns SMLIB_TIME_TO_TRIP_NEVER if the present current can be sustained
+ *  and 0 if already tripped.  The lower of the motor and controller bank
+ *  predictions is used as either will stop the motor.
+ */
+float
+SmartMotorGetTimeToTrip( tVexMotor index )
+{
+    smartMotor  *m;
+
+    // bounds check index
+    if((index < 0) || (index >= kVexMotorNum))
+        return( SMLIB_TIME_TO_TRIP_NEVER );
+
+    m = _SmartMotorGetPtr( index );
+
+    if( m->bank != NULL && m->bank->time_to_trip < m->time_to_trip )
+        return( m->bank->time_to_trip );
+
+    return( m->time_to_trip );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Set Motor current limit                                        */
 /** @param[in]  index The motor index                                          */
@@ -324,6 +358,27 @@ SmartMotorSetSlewRate( tVexMotor index, int slew_rate )
     sMotors[ index ].motor_slew = slew_rate;
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Set Motor priority for the current budget                      */
+/** @param[in]  index The motor index                                          */
+/** @param[in]  priority The priority, 0 (lowest) to SMLIB_PRIORITY_MAX        */
+/*-----------------------------------------------------------------------------*/
+
+void
+SmartMotorSetPriority( tVexMotor index, short priority )
+{
+    // bounds check index
+    if((index < 0) || (index >= kVexMotorNum))
+        return;
+
+    if( priority < 0 )
+        priority = 0;
+    if( priority > SMLIB_PRIORITY_MAX )
+        priority = SMLIB_PRIORITY_MAX;
+
+    sMotors[ index ].priority = priority;
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Get Controller current                                         */
 /** @param[in]  index The motor controller index (0, 1 or 2)                   */
@@ -355,6 +410,33 @@ SmartMotorGetControllerTemperature( short index )
     return( sPorts[ index ].temperature );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get Controller predicted time to PTC trip                      */
+/** @param[in]  index The motor controller index (0, 1 or 2)                   */
+/** @returns    Seconds until the PTC trips at present current                 */
+/*-----------------------------------------------------------------------------*/
+
+float
+SmartMotorGetControllerTimeToTrip( short index )
+{
+    // bounds check index
+    if((index < 0) || (index >= SMLIB_TOTAL_NUM_CONTROL_BANKS))
+        return( SMLIB_TIME_TO_TRIP_NEVER );
+
+    return( sPorts[ index ].time_to_trip );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Get the total current budget                                   */
+/** @returns    The current in amps available to all motors                    */
+/*-----------------------------------------------------------------------------*/
+
+float
+SmartMotorGetBudget()
+{
+    return( BudgetCurrent );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Set Controller status LED                                      */
 /** @param[in]  index The motor controller index (0, 1 or 2)                   */
@@ -438,6 +520,29 @@ SmartMotorCurrentMonitorDisable()
     CurrentLimitEnabled = FALSE;
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Enable sharing the available current between motors           */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Can be used with either the PTC or current monitor, the lowest command
+ *  limit wins.
+ */
+void
+SmartMotorBudgetEnable()
+{
+    BudgetEnabled = TRUE;
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Disable sharing the available current between motors          */
+/*-----------------------------------------------------------------------------*/
+
+void
+SmartMotorBudgetDisable()
+{
+    BudgetEnabled = FALSE;
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Start the smart motor monitoring                               */
 /** After initialization the smart motor tasks need to be started              */
@@ -461,6 +566,7 @@ SmartMotorStop()
 {
     SmartMotorPtcMonitorDisable();
     SmartMotorCurrentMonitorDisable();
+    SmartMotorBudgetDisable();
 
     StopTask( SmartMotorTask );
     StopTask( SmartMotorSlewRateTask );
@@ -491,7 +597,8 @@ SmartMotorDebugStatus()
 
         vex_printf("Current:%5.2f ", s->current);
         vex_printf("Temp:%6.2f ", s->temperature);
-        vex_printf("Status:%2d ", s->ptc_tripped);
+        vex_printf("Status:%2d ", s->ptc_tripped + (s->derating<<2) );
+        vex_printf("Trip:%6.1f ", s->time_to_trip);
         vex_printf("\r\n");
 
         for(i=0;i<SMLIB_TOTAL_NUM_BANK_MOTORS;i++)
@@ -503,11 +610,28 @@ SmartMotorDebugStatus()
                 vex_printf("Current:%5.2f ", m->current);
                 vex_printf("Temp:%6.2f ", m->temperature);
                 vex_printf("Status:%2d ", m->ptc_tripped + (m->limit_tripped<<1) );
+                vex_printf("Trip:%6.1f ", m->time_to_trip);
                 vex_printf("\r\n");
                 }
             }
         vex_printf("\r\n");
         }
+
+    if( BudgetEnabled )
+        {
+        vex_printf("Budget:%5.2f\r\n", BudgetCurrent);
+        for(i=0;i<kVexMotorNum;i++)
+            {
+            m = _SmartMotorGetPtr( i );
+            if( m->type == kVexMotorUndefined )
+                continue;
+            vex_printf("      Motor Port: %d - ", m->port );
+            vex_printf("Priority:%d ", m->priority);
+            vex_printf("Demand:%5.2f ", m->demand_current);
+            vex_printf("Grant:%5.2f ", m->budget_current);
+            vex_printf("\r\n");
+            }
+        }
 }
 
 
@@ -587,6 +711,9 @@ SmartMotorsInit()
         sPorts[j].current      = 0;
         sPorts[j].peak_current = 0;
         sPorts[j].safe_current = SMLIB_I_SAFECORTEX; // cortex and PE the same
+        sPorts[j].ptc_tripped  = FALSE;
+        sPorts[j].derating     = FALSE;
+        sPorts[j].time_to_trip = SMLIB_TIME_TO_TRIP_NEVER;
         sPorts[j].statusLed    = kVexDigital_None;
         sPorts[j].statusPort   = kVexAnalog_None;
         }
@@ -726,6 +853,13 @@ SmartMotorsInit()
         m->limit_tripped = FALSE;
         m->ptc_tripped   = FALSE;
         m->limit_cmd     = SMLIB_MOTOR_MAX_CMD_UNDEFINED;
+        m->time_to_trip  = SMLIB_TIME_TO_TRIP_NEVER;
+
+        // no budget limit until allocated
+        m->priority       = 0;
+        m->budget_cmd     = SMLIB_MOTOR_MAX_CMD_UNDEFINED;
+        m->demand_current = 0;
+        m->budget_current = 0;
 
         // maximum theoretical v_bemf
         m->v_bemf_max = m->ke_motor * m->rpm_free;
@@ -1047,7 +1181,7 @@ SmartMotorSensorSpeed( smartMotor *m, int deltaTime )
  *  If cmd is positive then rpm must also be positive for this to work.
  */
 
-float
+VEX_RAMTEXT float
 SmartMotorCurrent( smartMotor *m, float v_battery  )
 {
     float   v_bemf;
@@ -1060,31 +1194,45 @@ SmartMotorCurrent( smartMotor *m, float v_battery  )
     float   i_ss_on, i_ss_off;
 
     int     dir;
+    int     cmd, cmd_max;
+    float   pwm_freq;
 
-    // get current cmd
-    int     cmd = vexMotorGet( m->port );
+    // get current cmd, after any linearization in the motor driver
+    // ports 1 and 10 are driven by the cortex at higher resolution and
+    // may have a different pwm frequency
+    if( (pwm_freq = vexMotorPwmFreqGet( m->port )) > 0 )
+        {
+        cmd     = vexMotorOutputGetExt( m->port );
+        cmd_max = VEX_MOTOR_PWM_MAX;
+        }
+    else
+        {
+        cmd     = vexMotorOutputGet( m->port );
+        cmd_max = 127;
+        pwm_freq = SMLIB_PWM_FREQ;
+        }
 
     // rescale control value
     // ports 2 through 9 behave a little differently
     if( m->port > kVexMotor_1 && m->port < kVexMotor_10 )
         cmd = (cmd * 128) / 90;
 
-    // clip control value to +/- 127
-    if( abs(cmd) > 127 )
-        cmd = sgn(cmd) * 127;
+    // clip control value to +/- full scale
+    if( abs(cmd) > cmd_max )
+        cmd = sgn(cmd) * cmd_max;
 
     // which way are we turning ?
     // modified to use rpm near command value of 0 to reduce transients
-    if( abs(cmd) > 10 )
+    if( abs(cmd) > (10 * cmd_max) / 127 )
         dir = sgn(cmd);
     else
         dir = sgn(m->rpm);
 
 
-    duty_on = abs(cmd)/127.0;
+    duty_on = abs(cmd) / (float)cmd_max;
 
     // constants for this pwm cycle
-    lamda = m->r_motor/((float)SMLIB_PWM_FREQ * m->l_motor);
+    lamda = m->r_motor/(pwm_freq * m->l_motor);
     c1    = fastexp( -lamda *    duty_on  );
     c2    = fastexp( -lamda * (1-duty_on) );
 
@@ -1175,38 +1323,24 @@ SmartMotorControllerCurrent( smartController *s )
 }
 
 /*-----------------------------------------------------------------------------*/
-/** @brief      Calculate safe current command                                 */
+/** @brief      Calculate the command that will draw a given current           */
 /** @param[in]  m Pointer to smartMotor structure                              */
+/** @param[in]  current The current in A, must be POSITIVE                     */
+/** @param[in]  cmd A command with the polarity wanted                         */
 /** @param[in]  v_battery The battery voltage in volts                         */
-/** @returns    The calculated command value                                   */
+/** @returns    The calculated command value with the same polarity as cmd    */
 /** @warning    Internal smartMotorLibrary function, do not call, ref only     */
 /*-----------------------------------------------------------------------------*/
-/** @details
- *  Calculate a command for the motor which will result in a target
- *  current based on motor speed.
- *
- *  target_current should be set prior to calling the function and must
- *  be POSITIVE.
- *
- *  If command direction and rpm are not of the same polarity then this
- *  function tends to fallover due to back emf being of opposite direction
- *  to the drive direction.  In this situation we have no choice but to
- *  let current go higher as the motor is changing directions and will in
- *  effect stall as it does through zero.
- */
 
-int
-SmartMotorSafeCommand( smartMotor *m, float v_battery  )
+static int
+_SmartMotorCurrentCommand( smartMotor *m, float current, int cmd, float v_battery )
 {
-    // get current cmd
-    int     cmd = vexMotorGet( m->port );
-
     // cmd polarity must match rpm polarity
     // broken up a bit to reduce multiplies
     if (cmd >= 0)
         {
         if (m->rpm >= 0)
-            cmd = SMLIB_MOTOR_MAX_CMD * ((m->rpm * m->ke_motor) + (m->target_current * (m->r_motor + SMLIB_R_SYS)) + SMLIB_V_DIODE) / ( v_battery + SMLIB_V_DIODE );
+            cmd = SMLIB_MOTOR_MAX_CMD * ((m->rpm * m->ke_motor) + (current * (m->r_motor + SMLIB_R_SYS)) + SMLIB_V_DIODE) / ( v_battery + SMLIB_V_DIODE );
         else
             cmd = SMLIB_MOTOR_MAX_CMD;
 
@@ -1217,7 +1351,7 @@ SmartMotorSafeCommand( smartMotor *m, float v_battery  )
     else
         {
         if(m->rpm <= 0)
-            cmd = SMLIB_MOTOR_MAX_CMD * ((m->rpm * m->ke_motor) - (m->target_current * (m->r_motor + SMLIB_R_SYS)) - SMLIB_V_DIODE) / ( v_battery + SMLIB_V_DIODE );
+            cmd = SMLIB_MOTOR_MAX_CMD * ((m->rpm * m->ke_motor) - (current * (m->r_motor + SMLIB_R_SYS)) - SMLIB_V_DIODE) / ( v_battery + SMLIB_V_DIODE );
         else
             cmd = SMLIB_MOTOR_MIN_CMD;
 
@@ -1227,7 +1361,7 @@ SmartMotorSafeCommand( smartMotor *m, float v_battery  )
         }
 
     // override if current is 0
-    if( m->target_current == 0 )
+    if( current == 0 )
         cmd = 0;
 
     // ports 2 through 9 behave a little differently
@@ -1237,6 +1371,33 @@ SmartMotorSafeCommand( smartMotor *m, float v_battery  )
     return( cmd );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate safe current command                                 */
+/** @param[in]  m Pointer to smartMotor structure                              */
+/** @param[in]  v_battery The battery voltage in volts                         */
+/** @returns    The calculated command value                                   */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Calculate a command for the motor which will result in a target
+ *  current based on motor speed.
+ *
+ *  target_current should be set prior to calling the function and must
+ *  be POSITIVE.
+ *
+ *  If command direction and rpm are not of the same polarity then this
+ *  function tends to fallover due to back emf being of opposite direction
+ *  to the drive direction.  In this situation we have no choice but to
+ *  let current go higher as the motor is changing directions and will in
+ *  effect stall as it does through zero.
+ */
+
+int
+SmartMotorSafeCommand( smartMotor *m, float v_battery  )
+{
+    return( _SmartMotorCurrentCommand( m, m->target_current, vexMotorGet( m->port ), v_battery ) );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Calculate the PTC temperature for a motor                      */
 /** @param[in]  m Pointer to smartMotor structure                              */
@@ -1279,6 +1440,92 @@ SmartMotorControllerTemperature( smartController *s, int deltaTime  )
     return( s->temperature );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Predict time until a PTC trips                                 */
+/** @param[in]  temperature The present PTC temperature                       */
+/** @param[in]  current The present current                                   */
+/** @param[in]  t_ambient The ambient temperature                              */
+/** @param[in]  c1 The PTC constant t_const_1                                  */
+/** @param[in]  c2 The PTC constant t_const_2                                  */
+/** @returns    The time in seconds                                            */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  With constant current the temperature approaches t_ambient + c1 * i^2
+ *  exponentially with a time constant of 1/c2 mS.  If that is below the
+ *  trip temperature the PTC never trips, otherwise solve for the time the
+ *  trip temperature is reached.
+ */
+
+float
+SmartMotorPredictTrip( float temperature, float current, float t_ambient, float c1, float c2 )
+{
+    float   t_ss;
+    float   t;
+
+    if( temperature >= SMLIB_TEMP_TRIP )
+        return( 0 );
+
+    // steady state temperature
+    t_ss = t_ambient + (current * current * c1);
+    if( t_ss <= SMLIB_TEMP_TRIP )
+        return( SMLIB_TIME_TO_TRIP_NEVER );
+
+    // c2 is per mS
+    t = logf( (t_ss - temperature) / (t_ss - SMLIB_TEMP_TRIP) ) / (c2 * 1000.0);
+
+    if( t > SMLIB_TIME_TO_TRIP_NEVER )
+        t = SMLIB_TIME_TO_TRIP_NEVER;
+
+    return( t );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate allowed current as the PTC heats up                  */
+/** @param[in]  temperature The present PTC temperature                       */
+/** @param[in]  i_max The current allowed below SMLIB_TEMP_DERATE             */
+/** @param[in]  i_safe The current allowed at the trip temperature             */
+/** @returns    The allowed current                                            */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  A smoothstep between SMLIB_TEMP_DERATE and SMLIB_TEMP_TRIP so there is
+ *  no sudden change in the limit at either end.
+ */
+
+float
+SmartMotorDerate( float temperature, float i_max, float i_safe )
+{
+    float   f;
+
+    f = (temperature - SMLIB_TEMP_DERATE) / (SMLIB_TEMP_TRIP - SMLIB_TEMP_DERATE);
+
+    if( f <= 0 )
+        return( i_max );
+    if( f >= 1 )
+        return( i_safe );
+
+    f = f * f * (3.0 - (2.0 * f));
+
+    return( i_max - ((i_max - i_safe) * f) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Calculate the current a motor PTC will allow                   */
+/** @param[in]  m Pointer to smartMotor structure                              */
+/** @returns    The allowed current, stall current if not limited             */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+
+float
+SmartMotorPtcCurrent( smartMotor *m )
+{
+    if( m->ptc_tripped )
+        return( m->safe_current );
+
+    return( SmartMotorDerate( m->temperature, m->i_stall, m->safe_current ) );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Monitor Motor PTC temperature                                  */
 /** @param[in]  m Pointer to smartMotor structure                              */
@@ -1287,7 +1534,9 @@ SmartMotorControllerTemperature( smartController *s, int deltaTime  )
 /*-----------------------------------------------------------------------------*/
 /** @details
  *  If the temperature is above the set point then calculate a command that
- *  will result in a safe current
+ *  will result in a safe current.  Between SMLIB_TEMP_DERATE and the set
+ *  point the allowed current is reduced smoothly so the motor slows down
+ *  before it would trip.
  */
 
 void
@@ -1303,20 +1552,20 @@ SmartMotorMonitorPtc( smartMotor *m, float v_battery )
             m->ptc_tripped = FALSE;
     }
 
-    // Is the bank ptc tripped ?
+    // Is the bank ptc tripped or derating ?
     // If so then leave limit_cmd alone
     if( m->bank != NULL )
         {
-        if( m->bank->ptc_tripped )
+        if( m->bank->ptc_tripped || m->bank->derating )
             return;
         }
 
-    // Is (or was) the ptc tripped
-    if( m->ptc_tripped )
+    // Is (or was) the ptc tripped or getting close
+    if( m->ptc_tripped || m->temperature > SMLIB_TEMP_DERATE )
         {
         // we are using target_current as a debugging means
         // it must be positive
-        m->target_current = m->safe_current;
+        m->target_current = SmartMotorPtcCurrent( m );
         // maximum cmd value
         m->limit_cmd = SmartMotorSafeCommand( m, v_battery);
         }
@@ -1335,7 +1584,9 @@ SmartMotorMonitorPtc( smartMotor *m, float v_battery )
 /*-----------------------------------------------------------------------------*/
 /** @details
  *  If the temperature is above the set point then calculate a commands for
- *  each motor that will result in a safe current.
+ *  each motor that will result in a safe current.  Between SMLIB_TEMP_DERATE
+ *  and the set point the bank current is reduced smoothly from the PTC
+ *  trip test current (5 x hold) to the safe current.
  *
  */
 
@@ -1344,6 +1595,7 @@ SmartMotorControllerMonitorPtc( smartController *s, float v_battery )
 {
     smartMotor    *m;
     int            i;
+    float          bank_current;
 
     if( !s->ptc_tripped ) {
         if( s->temperature > SMLIB_TEMP_TRIP )
@@ -1355,9 +1607,16 @@ SmartMotorControllerMonitorPtc( smartController *s, float v_battery )
             s->ptc_tripped = FALSE;
     }
 
-    // Is (or was) the PTC tripped
-    // this will constantly be recalculated
+    // current allowed by the bank, reduced as the ptc heats up
+    s->derating = (!s->ptc_tripped && (s->temperature > SMLIB_TEMP_DERATE));
     if( s->ptc_tripped )
+        bank_current = s->safe_current;
+    else
+        bank_current = SmartMotorDerate( s->temperature, SMLIB_I_HOLD_CORTEX * 5.0, s->safe_current );
+
+    // Is (or was) the PTC tripped or getting close
+    // this will constantly be recalculated
+    if( s->ptc_tripped || s->derating )
         {
         // now decide how to fix it.
         // divide amongst active motors, same current for each one we are using
@@ -1378,7 +1637,7 @@ SmartMotorControllerMonitorPtc( smartController *s, float v_battery )
             active_motors = 1;
 
         // calculate safe current based on number of active motors
-        float m_safe_current = s->safe_current / active_motors;
+        float m_safe_current = bank_current / active_motors;
 
         for(i=0;i<SMLIB_TOTAL_NUM_BANK_MOTORS;i++)
             {
@@ -1387,9 +1646,11 @@ SmartMotorControllerMonitorPtc( smartController *s, float v_battery )
                 {
                 // using target_current as a debugging means
                 // it must be positive
-                // see if the motor is tripped as well and use lowest current
-                if( m->ptc_tripped && (m->safe_current < m_safe_current) )
-                    m->target_current = m->safe_current;
+                // see if the motor is tripped or derating as well and use
+                // lowest current
+                float m_ptc_current = SmartMotorPtcCurrent( m );
+                if( m_ptc_current < m_safe_current )
+                    m->target_current = m_ptc_current;
                 else
                     m->target_current = m_safe_current;
 
@@ -1431,6 +1692,172 @@ SmartMotorMonitorCurrent( smartMotor *m, float v_battery )
         m->limit_cmd = SMLIB_MOTOR_MAX_CMD_UNDEFINED;
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Estimate the current a motor would draw at its command         */
+/** @param[in]  m Pointer to smartMotor structure                              */
+/** @param[in]  v_battery The battery voltage in volts                         */
+/** @returns    The current in amps, always positive                          */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  Uses the user command (motor_cmd) rather than the limited value sent to
+ *  the motor so that a motor held back by the budget still asks for what
+ *  it needs.  This is the inverse of SmartMotorSafeCommand.
+ */
+
+float
+SmartMotorDemandCurrent( smartMotor *m, float v_battery )
+{
+    int     cmd = m->motor_cmd;
+    float   v;
+
+    if( cmd == 0 )
+        return( 0 );
+
+    // ports 2 through 9 behave a little differently
+    if( m->port > kVexMotor_1 && m->port < kVexMotor_10 )
+        {
+        cmd = (cmd * 128) / 90;
+        if( abs(cmd) > SMLIB_MOTOR_MAX_CMD )
+            cmd = sgn(cmd) * SMLIB_MOTOR_MAX_CMD;
+        }
+
+    // drive voltage less back emf in the direction of the command
+    v = sgn(cmd) * ((cmd * (v_battery + SMLIB_V_DIODE) / SMLIB_MOTOR_MAX_CMD) - (m->rpm * m->ke_motor)) - SMLIB_V_DIODE;
+
+    if( v <= 0 )
+        return( 0 );
+
+    return( v / (m->r_motor + SMLIB_R_SYS) );
+}
+
+/*-----------------------------------------------------------------------------*/
+/** @brief      Share the available current between motors                     */
+/** @param[in]  v_battery The battery voltage in volts                         */
+/** @warning    Internal smartMotorLibrary function, do not call, ref only     */
+/*-----------------------------------------------------------------------------*/
+/** @details
+ *  The total budget is the current that would pull the battery down to
+ *  SMLIB_V_BROWNOUT, each bank is also limited to its safe current.
+ *  Starting with the highest priority, motors are given the current they
+ *  demand.  When there is not enough left all motors at that priority are
+ *  scaled back by the same amount and any lower priority motors get
+ *  nothing.  A motor given less than it demands has budget_cmd set to
+ *  a command, with the polarity of motor_cmd, that will draw the granted
+ *  current.  A budget_cmd of 0 means the motor was granted nothing.
+ */
+
+void
+SmartMotorAllocateBudget( float v_battery )
+{
+    smartMotor      *m;
+    smartController *s;
+    float   bank_avail[SMLIB_TOTAL_NUM_CONTROL_BANKS];
+    float   bank_demand[SMLIB_TOTAL_NUM_CONTROL_BANKS];
+    float   avail, total, demand, scale, grant;
+    int     i, b, p;
+
+    // bank limits and present total current
+    total = 0;
+    avail = 0;
+    for(i=0;i<SMLIB_TOTAL_NUM_CONTROL_BANKS;i++)
+        {
+        s = _SmartMotorControllerGetPtr( i );
+        bank_avail[i] = s->safe_current;
+        total += s->current;
+        avail += s->safe_current;
+        }
+
+    // battery limit, estimate open circuit voltage from the loaded voltage
+    // no battery reading if the master is not talking to us
+    if( v_battery > 0 )
+        {
+        float i_batt = (v_battery + (total * SMLIB_R_BATTERY) - SMLIB_V_BROWNOUT) / SMLIB_R_BATTERY;
+        if( i_batt < 0 )
+            i_batt = 0;
+        if( i_batt < avail )
+            avail = i_batt;
+        }
+
+    BudgetCurrent = avail;
+
+    for(i=0;i<kVexMotorNum;i++)
+        {
+        m = _SmartMotorGetPtr( i );
+        if( m->type != kVexMotorUndefined )
+            m->demand_current = SmartMotorDemandCurrent( m, v_battery );
+        else
+            m->demand_current = 0;
+        }
+
+    for(p=SMLIB_PRIORITY_MAX;p>=0;p--)
+        {
+        // total demand at this priority, overall and for each bank
+        demand = 0;
+        for(b=0;b<SMLIB_TOTAL_NUM_CONTROL_BANKS;b++)
+            bank_demand[b] = 0;
+
+        for(i=0;i<kVexMotorNum;i++)
+            {
+            m = _SmartMotorGetPtr( i );
+            if( m->priority != p || m->demand_current == 0 )
+                continue;
+            demand += m->demand_current;
+            if( m->bank != NULL )
+                bank_demand[ m->bank - sPorts ] += m->demand_current;
+            }
+
+        if( demand == 0 )
+            continue;
+
+        scale = (demand > avail) ? avail / demand : 1.0;
+
+        // same share for every motor on a bank, bank may be lower than overall
+        for(i=0;i<kVexMotorNum;i++)
+            {
+            m = _SmartMotorGetPtr( i );
+            if( m->priority != p )
+                continue;
+
+            grant = m->demand_current * scale;
+            if( m->bank != NULL )
+                {
+                b = m->bank - sPorts;
+                if( bank_demand[b] * scale > bank_avail[b] )
+                    grant = m->demand_current * bank_avail[b] / bank_demand[b];
+                }
+
+            m->budget_current = grant;
+            }
+
+        // remove what was given from what is left
+        for(i=0;i<kVexMotorNum;i++)
+            {
+            m = _SmartMotorGetPtr( i );
+            if( m->priority != p )
+                continue;
+
+            avail -= m->budget_current;
+            if( m->bank != NULL )
+                bank_avail[ m->bank - sPorts ] -= m->budget_current;
+            }
+        if( avail < 0 )
+            avail = 0;
+        }
+
+    // command limit for any motor not given all it asked for
+    for(i=0;i<kVexMotorNum;i++)
+        {
+        m = _SmartMotorGetPtr( i );
+
+        // target_current belongs to the ptc and current monitors
+        if( m->demand_current > 0 && m->budget_current < (m->demand_current - 0.05) )
+            m->budget_cmd = _SmartMotorCurrentCommand( m, m->budget_current, m->motor_cmd, v_battery );
+        else
+            m->budget_cmd = SMLIB_MOTOR_MAX_CMD_UNDEFINED;
+        }
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Set the current monitor LED on or off                          */
 /** @param[in]  s Pointer to smartController structure                         */
@@ -1486,14 +1913,19 @@ SmartMotorTask( void *arg )
             int i;
             int nextMotor = 0;
             float   v_battery;
+    static  vexPerfPeriodic perf;
 
     (void)arg;
 
     // Must call this - but we are not terminated
     vexTaskRegisterPersistant("smartMotor", TRUE);
 
+    vexPerfPeriodicInit( &perf, "smartMotor", loopDelay * 1000, 0 );
+
     while(!chThdShouldTerminate())
         {
+        vexPerfPeriodicStart( &perf );
+
 #ifdef  _smTestPoint_1
         // debug time spent in this task
         vexDigitalPinSet( _smTestPoint_1, 1);
@@ -1523,6 +1955,8 @@ SmartMotorTask( void *arg )
 
             SmartMotorCurrent( m, v_battery );
             SmartMotorTemperature( m, delayTimeMs );
+            m->time_to_trip = m->ptc_tripped ? 0 :
+                SmartMotorPredictTrip( m->temperature, m->current, m->t_ambient, m->t_const_1, m->t_const_2 );
             if( PtcLimitEnabled )
                 SmartMotorMonitorPtc( m, v_battery );
             if( CurrentLimitEnabled )
@@ -1547,6 +1981,8 @@ SmartMotorTask( void *arg )
 
                 SmartMotorControllerCurrent( s );
                 SmartMotorControllerTemperature( s, delayTimeMs );
+                s->time_to_trip = s->ptc_tripped ? 0 :
+                    SmartMotorPredictTrip( s->temperature, s->current, s->t_ambient, s->t_const_1, s->t_const_2 );
 
                 if( PtcLimitEnabled )
                     SmartMotorControllerMonitorPtc( s, v_battery );
@@ -1558,6 +1994,10 @@ SmartMotorTask( void *arg )
                     vexDigitalPinSet( s->statusLed, SMLIB_LEDOFF);
                 }
 
+            // share what current is available between all motors
+            if( BudgetEnabled )
+                SmartMotorAllocateBudget( v_battery );
+
             // check status LED
             for( i=0;i<SMLIB_TOTAL_NUM_CONTROL_BANKS;i++ )
                 {
@@ -1587,6 +2027,8 @@ SmartMotorTask( void *arg )
         // debug time spent in this task
         vexDigitalPinSet( _smTestPoint_1, 0);
 #endif
+        vexPerfPeriodicEnd( &perf );
+
         // wait
         vexSleep(loopDelay);
         }
@@ -1610,6 +2052,7 @@ msg_t SmartMotorSlewRateTask( void *arg )
     static  int delayTimeMs = 15;
     int motorIndex;
     int motorTmp;
+    int limit;
     smartMotor  *m;
 
     (void)arg;
@@ -1641,13 +2084,29 @@ msg_t SmartMotorSlewRateTask( void *arg )
             // So we don't keep accessing the internal storage
             motorTmp = vexMotorGet( m->port );
 
+            // lowest of the ptc or current limit and the budget limit
+            limit = SMLIB_MOTOR_MAX_CMD_UNDEFINED;
+            if( PtcLimitEnabled || CurrentLimitEnabled )
+                limit = m->limit_cmd;
+            if( BudgetEnabled && (m->budget_cmd != SMLIB_MOTOR_MAX_CMD_UNDEFINED) )
+                {
+                if( (limit == SMLIB_MOTOR_MAX_CMD_UNDEFINED) || (abs(m->budget_cmd) < abs(limit)) )
+                    limit = m->budget_cmd;
+                }
+
             // check for limiting
-            if( (PtcLimitEnabled || CurrentLimitEnabled) && (m->limit_cmd != SMLIB_MOTOR_MAX_CMD_UNDEFINED) )
+            if( BudgetEnabled && m->budget_cmd == 0 )
+                {
+                // no current granted, stop whatever the direction
+                m->motor_req = 0;
+                }
+            else
+            if( limit != SMLIB_MOTOR_MAX_CMD_UNDEFINED )
                 {
-                if( abs(m->motor_cmd) > abs(m->limit_cmd) ) {
+                if( abs(m->motor_cmd) > abs(limit) ) {
                     // don't limit if we are reversing direction
-                    if( sgn(m->motor_cmd) == sgn(m->limit_cmd) )
-                        m->motor_req = m->limit_cmd;
+                    if( sgn(m->motor_cmd) == sgn(limit) )
+                        m->motor_req = limit;
                     else
                         m->motor_req = m->motor_cmd;
                     }
@@ -85,6 +85,14 @@
 #define SMLIB_I_SAFECORTEX      3.0
 #define SMLIB_I_SAFEPE          3.0
 
+// parameters for the global current budget
+// battery internal plus wiring resistance and the battery voltage where
+// the cortex may reset, together they limit the total current we can draw
+#define SMLIB_R_BATTERY         0.15
+#define SMLIB_V_BROWNOUT        5.5
+// motors are given current in order of priority, 0 is lowest
+#define SMLIB_PRIORITY_MAX      7
+
 // encoder counts per revolution depending on motor
 #define SMLIB_TPR_269           240.448
 #define SMLIB_TPR_393R          261.333
@@ -101,6 +109,11 @@
 #define SMLIB_TEMP_HYST         10.0
 // Reference temperature for data below, 25 deg C
 #define SMLIB_TEMP_REF          25.0
+// Start reducing the allowed current at 80 deg C, reaches safe current at the
+// trip temperature
+#define SMLIB_TEMP_DERATE       80.0
+// Time to trip in seconds when the PTC will not trip at the present current
+#define SMLIB_TIME_TO_TRIP_NEVER    1000.0
 
 // Hold current is the current where thr PTC should not trip
 // Time to trip is the time at 5 x hold current
@@ -183,6 +196,13 @@ typedef struct {
     short   limit_cmd;
     float   limit_current;
 
+    // global current budget, priority and the current we were given
+    // budget_cmd is the max cmd value when the grant is below demand
+    short   priority;
+    short   budget_cmd;
+    float   demand_current;
+    float   budget_current;
+
     // the encoder associated with this motor
     short   encoder_id;
     // encoder ticks per rev
@@ -221,6 +241,8 @@ typedef struct {
     float   t_const_2;
     float   t_ambient;
     short   ptc_tripped;
+    // predicted seconds until the PTC trips at the present current
+    float   time_to_trip;
 
     // Last program time we ran - may not keep this, bit overkill
     long    lastPgmTime;
@@ -277,6 +299,10 @@ typedef struct _smartController {
 
     // flag for ptc status
     short  ptc_tripped;
+    // flag for current reduced as the ptc heats up
+    short  derating;
+    // predicted seconds until the PTC trips at the present current
+    float  time_to_trip;
 
     // Do we have an led to show tripped status
     tVexDigitalPin statusLed;
@@ -306,15 +332,21 @@ float            SmartMotorGetSpeed( tVexMotor index );
 float            _SmartMotorGetCurrent( tVexMotor index, int s, ... );
 float            SmartMotorGetTemperature( tVexMotor index );
 int              SmartMotorGetLimitCmd( tVexMotor index );
+float            SmartMotorGetTimeToTrip( tVexMotor index );
 
 float            SmartMotorGetControllerCurrent( short index );
 float            SmartMotorGetControllerTemperature( short index );
+float            SmartMotorGetControllerTimeToTrip( short index );
+float            SmartMotorGetBudget( void );
 
 // Control
 void             SmartMotorPtcMonitorEnable( void );
 void             SmartMotorPtcMonitorDisable( void );
 void             SmartMotorCurrentMonitorEnable( void );
 void             SmartMotorCurrentMonitorDisable( void );
+void             SmartMotorBudgetEnable( void );
+void             SmartMotorBudgetDisable( void );
+void             SmartMotorSetPriority( tVexMotor index, short priority );
 #define          SmartMotorSetLimitCurent(index, ... ) \
                  _SmartMotorSetLimitCurent( index, ##__VA_ARGS__, 1.0 )
 void             _SmartMotorSetLimitCurent( tVexMotor index, float current, ... );
@@ -345,9 +377,14 @@ float            SmartMotorControllerCurrent( smartController *s );
 int              SmartMotorSafeCommand( smartMotor *m, float v_battery  );
 float            SmartMotorTemperature( smartMotor *m, int deltaTime );
 float            SmartMotorControllerTemperature( smartController *s, int deltaTime  );
+float            SmartMotorPredictTrip( float temperature, float current, float t_ambient, float c1, float c2 );
+float            SmartMotorDerate( float temperature, float i_max, float i_safe );
+float            SmartMotorPtcCurrent( smartMotor *m );
 void             SmartMotorMonitorPtc( smartMotor *m, float v_battery );
 void             SmartMotorControllerMonitorPtc( smartController *s, float v_battery );
 void             SmartMotorMonitorCurrent( smartMotor *m, float v_battery );
+float            SmartMotorDemandCurrent( smartMotor *m, float v_battery );
+void             SmartMotorAllocateBudget( float v_battery );
 void             SmartMotorControllerSetLed( smartController *s );
 msg_t            SmartMotorTask( void *arg );
 msg_t            SmartMotorSlewRateTask( void *arg );
@@ -64,6 +64,9 @@ static WORKING_AREA(waVexGyroTask, USER_TASK_STACK_SIZE);
 // final value in deg * 10
 static int32_t     GyroValue = 0;
 
+// set when the bias has been found
+static bool_t      GyroReady = FALSE;
+
 // filter out noise.
 const int GyroJitterRange = 4;
 
@@ -100,6 +103,8 @@ vexGyroTask(void *arg)
     GyroBias      = GyroBiasAcc / 1024;
     GyroSmallBias = GyroBiasAcc - (GyroBias * 1024);
     // Ok bias done
+    GyroReady = TRUE;
+    vexBootMark( kVexBootGyroReady );
 
     while(!chThdShouldTerminate())
         {
@@ -140,6 +145,17 @@ vexGyroGet()
     return( GyroValue );
 }
 
+/*-----------------------------------------------------------------------------*/
+/** @brief      Check if gyro calibration has finished                         */
+/** @returns    TRUE if the gyro is calibrated                                 */
+/*-----------------------------------------------------------------------------*/
+
+bool_t
+vexGyroReady()
+{
+    return( GyroReady );
+}
+
 /*-----------------------------------------------------------------------------*/
 /** @brief      Init the gyro task                                            */
 /*-----------------------------------------------------------------------------*/
@@ -151,6 +167,9 @@ vexGyroInit( tVexAnalogPin pin )
         return;
 
     gyroAnalogPin = pin;
+    // not ready first, a reset then looks like a step while calibrating
+    GyroReady     = FALSE;
+    GyroValue     = 0;
 
     gyroThread = chThdCreateStatic(waVexGyroTask, sizeof(waVexGyroTask), USER_THREAD_PRIORITY, vexGyroTask, NULL);
 }
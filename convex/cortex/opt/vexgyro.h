@@ -57,6 +57,7 @@ extern "C" {
 
 void        vexGyroInit(tVexAnalogPin pin);
 int32_t     vexGyroGet(void);
+bool_t      vexGyroReady(void);
 void        vexGyroReset(void);
 
 #ifdef __cplusplus
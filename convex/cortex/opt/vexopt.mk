@@ -3,6 +3,10 @@ VEXOPTSRC = ${CONVEX}/opt/robotc_glue.c \
             ${CONVEX}/opt/smartmotor.c \
             ${CONVEX}/opt/apollo.c \
             ${CONVEX}/opt/pidlib.c \
+            ${CONVEX}/opt/motionprofile.c \
+            ${CONVEX}/opt/odometry.c \
+            ${CONVEX}/opt/flywheel.c \
+            ${CONVEX}/opt/drivetrain.c \
             ${CONVEX}/opt/vexgyro.c \
             ${CONVEX}/opt/vexflash.c \
             ${CONVEX}/opt/stm32_flash.c
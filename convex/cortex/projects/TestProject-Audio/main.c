@@ -110,7 +110,6 @@ static const ShellConfig shell_cfg1 = {
 int main(void)
 {
 	Thread *shelltp = NULL;
-	short	timeout = 0;
 
 	// System initializations.
     // - HAL initialization, this also initializes the configured device drivers
@@ -128,15 +127,8 @@ int main(void)
     // init VEX
     vexCortexInit();
 
-    // wait for good spi comms
-    while( vexSpiGetOnlineStatus() == 0 )
-    	{
-        // wait for a while
-        chThdSleepMilliseconds(100);
-        // dump after 5 seconds
-        if(timeout++ == 50)
-        	break;
-    	}
+    // wait for good spi comms, dump after 5 seconds
+    vexBootWait( kVexBootSpiOnline, MS2ST(5000) );
 
     // Shell manager initialization.
     shellInit();
@@ -46,6 +46,7 @@
 #include "hal.h" 		// hardware abstraction layer header
 #include "vex.h"		// vex library header
 #include "smartmotor.h"
+#include "drivetrain.h"
 
 // Digi IO configuration
 static	vexDigiCfg	dConfig[kVexDigital_Num] = {
@@ -106,12 +107,20 @@ RtttlDemo( int tune )
         }
 }
 
+// Joystick shaping, deadband of 10 and linear response
+static const vexCtlShape joyShape = { 10, 0, 100, FALSE };
+
 // Initialize the digital ports
 void
 vexUserSetup()
 {
 	vexDigitalConfigure( dConfig, DIG_CONFIG_SIZE( dConfig ) );
 	vexMotorConfigure( mConfig, MOT_CONFIG_SIZE( mConfig ) );
+
+	// joystick deadband
+	vexControllerShapeSet( Ch1, &joyShape );
+	vexControllerShapeSet( Ch2, &joyShape );
+	vexControllerShapeSet( Ch3, &joyShape );
 }
 
 // called before either autonomous or user control
@@ -121,6 +130,10 @@ vexUserInit()
     SmartMotorsInit();
     SmartMotorCurrentMonitorEnable();
     SmartMotorRun();
+
+    DriveInit( kDriveTank, TRUE );
+    DriveMotorAdd( kDriveLeft,  MotorDriveL );
+    DriveMotorAdd( kDriveRight, MotorDriveR );
 }
 
 // Autonomous control task
@@ -142,34 +155,6 @@ vexAutonomous( void *arg )
 }
 
 
-// arcade drive
-void
-DriveSystemArcadeDrive( int16_t forward, int16_t turn )
-{
-    int16_t drive_l_motor;
-    int16_t drive_r_motor;
-
-    // Set drive
-    drive_l_motor = forward + turn;
-    drive_r_motor = forward - turn;
-
-    // normalize drive so max is 127 if any drive is over 127
-    int16_t max = abs(drive_l_motor);
-    if (abs(drive_r_motor)  > max)
-        max = abs(drive_r_motor);
-    if (max>127) {
-        drive_l_motor = 127 * drive_l_motor / max;
-        drive_r_motor = 127 * drive_r_motor  / max;
-    }
-
-    // Send to motors
-    // left drive
-    SetMotor( MotorDriveL, drive_l_motor );
-
-    // right drive
-    SetMotor( MotorDriveR, drive_r_motor );
-}
-
 // Driver control task
 msg_t
 vexOperator( void *arg )
@@ -211,24 +196,14 @@ vexOperator( void *arg )
 		// status on LCD of encoder and sonar
 		vexLcdPrintf( VEX_LCD_DISPLAY_2, VEX_LCD_LINE_1, "Batt %4.2fV", vexSpiGetMainBattery() / 1000.0 );
 
-		// Get controller
-		if( abs( vexControllerGet( Ch2 )) > 10 )
-			forward = vexControllerGet( Ch2 );
-		else
-			forward = 0;
-
-		if( abs( vexControllerGet( Ch1 )) > 10 )
-			turn = vexControllerGet( Ch1 );
-		else
-			turn = 0;
+		// Get controller, deadband is set in vexUserSetup
+		forward = vexControllerShapedGet( Ch2 );
+		turn    = vexControllerShapedGet( Ch1 );
 
-        if( abs( vexControllerGet( Ch3 )) > 10 )
-            SetMotor( 1, vexControllerGet( Ch3 ) );
-        else
-            SetMotor( 1, 0 );
+        SetMotor( 1, vexControllerShapedGet( Ch3 ) );
 
 		// arcade drive
-		DriveSystemArcadeDrive( forward, turn );
+		DriveArcade( forward, turn );
 
 		// Don't hog cpu
 		vexSleep( 25 );
@@ -42,7 +42,6 @@ extern "C" {
 #endif
 
 
-void    DriveSystemArcadeDrive( short forward, short turn );
 task    DriveTask(void *arg);
 task    ArmPidController(void *arg);
 task    ClawController(void *arg);
@@ -51,6 +51,7 @@
 #include "vex.h"        // vex library header
 #include "smartmotor.h"
 #include "robotc_glue.h"
+#include "drivetrain.h"
 #include "clawbot.h"
 
 /*-----------------------------------------------------------------------------*/
@@ -98,39 +99,6 @@ static  vexMotorCfg mConfig[10] = {
 #define armPot          kVexAnalog_1
 #define clawPot         kVexAnalog_2
 
-/*-----------------------------------------------------------------------------*/
-/*  Drive control task                                                         */
-/*                                                                             */
-/*  Uses joystick Ch3, Ch4                                                     */
-/*-----------------------------------------------------------------------------*/
-
-void
-DriveSystemArcadeDrive( short forward, short turn )
-{
-    long drive_l_motor;
-    long drive_r_motor;
-
-    // Set drive
-    drive_l_motor = forward + turn;
-    drive_r_motor = forward - turn;
-
-    // normalize drive so max is 127 if any drive is over 127
-    int max = abs(drive_l_motor);
-    if (abs(drive_r_motor)  > max)
-        max = abs(drive_r_motor);
-    if (max>127) {
-        drive_l_motor = 127 * drive_l_motor / max;
-        drive_r_motor = 127 * drive_r_motor  / max;
-    }
-
-    // Send to motors
-    // left drive
-    SetMotor( MotorDriveL, drive_l_motor);
-
-    // right drive
-    SetMotor( MotorDriveR, drive_r_motor);
-}
-
 /*-----------------------------------------------------------------------------*/
 /*  Drive control task                                                         */
 /*-----------------------------------------------------------------------------*/
@@ -145,18 +113,11 @@ DriveTask(void *arg)
 
     while( TRUE )
         {
-        // Get controller
-        if( abs( vexControllerGet( Ch3 ) ) > 10 )
-            forward = vexControllerGet( Ch3 );
-        else
-            forward = 0;
-
-        if( abs( vexControllerGet( Ch4 ) ) > 10 )
-            turn = vexControllerGet( Ch4 );
-        else
-            turn = 0;
+        // Get controller, deadband is set in vexUserSetup
+        forward = vexControllerShapedGet( Ch3 );
+        turn    = vexControllerShapedGet( Ch4 );
 
-        DriveSystemArcadeDrive( forward, turn );
+        DriveArcade( forward, turn );
 
         wait1Msec(25);
         }
@@ -402,12 +363,19 @@ ManualArmClawTask(void *arg)
 
 
 
+// Joystick shaping, deadband of 10 and linear response
+static const vexCtlShape joyShape = { 10, 0, 100, FALSE };
+
 // Initialize the digital ports
 void
 vexUserSetup()
 {
     vexDigitalConfigure( dConfig, DIG_CONFIG_SIZE( dConfig ) );
     vexMotorConfigure( mConfig, MOT_CONFIG_SIZE( mConfig ) );
+
+    // joystick deadband
+    vexControllerShapeSet( Ch3, &joyShape );
+    vexControllerShapeSet( Ch4, &joyShape );
 }
 
 // called before either autonomous or user control
@@ -417,6 +385,10 @@ vexUserInit()
     SmartMotorsInit();
     SmartMotorCurrentMonitorEnable();
     SmartMotorRun();
+
+    DriveInit( kDriveTank, TRUE );
+    DriveMotorAdd( kDriveLeft,  MotorDriveL );
+    DriveMotorAdd( kDriveRight, MotorDriveR );
 }
 
 // Autonomous control task
@@ -440,10 +412,10 @@ vexAutonomous( void *arg )
     wait1Msec(2000);
 
     // Move forward
-    DriveSystemArcadeDrive( 100, 0 );
+    DriveArcade( 100, 0 );
     wait1Msec(1000);
     // Stop drivw
-    DriveSystemArcadeDrive( 0, 0 );
+    DriveStop();
 
     // Arm down
     SetArmPosition( 700 );
@@ -457,10 +429,10 @@ vexAutonomous( void *arg )
     SetArmPosition( 1000 );
     wait1Msec(1000);
     // Turn
-    DriveSystemArcadeDrive( 0, 100 );
+    DriveArcade( 0, 100 );
     wait1Msec(1000);
     // Stop drivw
-    DriveSystemArcadeDrive( 0, 0 );
+    DriveStop();
 
     // Claw Open
     ClawOpen();
@@ -50,6 +50,9 @@
 
 #include "smartmotor.h"
 #include "apollo.h"
+#include "pidlib.h"
+#include "robotc_glue.h"
+#include "odometry.h"
 
 /*-----------------------------------------------------------------------------*/
 /* Command line related.                                                       */
@@ -97,6 +100,19 @@ static const ShellCommand commands[] = {
   {"test",    vexTestDebug},
   {"sm",      cmd_sm },
   {"apollo",  cmd_apollo},
+  {"pid",     PidControllerDebug},
+  {"pidbench",PidControllerBench},
+  {"pidtune", PidControllerTuneDebug},
+  {"odo",     OdometryDebug},
+  {"boot",    vexBootDebug},
+  {"perf",    vexPerfDebug},
+  {"isr",     vexIsrDebug},
+  {"stack",   vexStackDebug},
+  {"rctask",  RobotcTaskDebug},
+  {"mode",    vexTransitionDebug},
+  {"ctl",     vexControllerDebug},
+  {"dig",     vexDigitalIntrDebug},
+  {"mbox",    vexMotorCommandDebug},
   {NULL, NULL}
 };
 
@@ -113,7 +129,6 @@ static const ShellConfig shell_cfg1 = {
 int main(void)
 {
 	Thread *shelltp = NULL;
-	short	timeout = 0;
 
 	// System initializations.
     // - HAL initialization, this also initializes the configured device drivers
@@ -131,15 +146,8 @@ int main(void)
     // init VEX
     vexCortexInit();
 
-    // wait for good spi comms
-    while( vexSpiGetOnlineStatus() == 0 )
-    	{
-        // wait for a while
-        chThdSleepMilliseconds(100);
-        // dump after 5 seconds
-        if(timeout++ == 50)
-        	break;
-    	}
+    // wait for good spi comms, dump after 5 seconds
+    vexBootWait( kVexBootSpiOnline, MS2ST(5000) );
 
     // Shell manager initialization.
     shellInit();
@@ -48,6 +48,9 @@
 #include "smartmotor.h"
 #include "robotc_glue.h"
 #include "pidlib.h"
+#include "vexgyro.h"
+#include "odometry.h"
+#include "drivetrain.h"
 #include "osr.h"
 
 // Digi IO configuration
@@ -124,21 +127,9 @@ DriveSystemMecanumDrive( )
 {
     short   forward, turn, right;
 
-    long drive_l_front;
-    long drive_l_back;
-    long drive_r_front;
-    long drive_r_back;
-
-    // Get controller
-    if( abs( vexControllerGet( Ch3) ) > 10 )
-        forward = vexControllerGet( Ch3 );
-    else
-        forward = 0;
-
-    if( abs( vexControllerGet( Ch4 ) ) > 10 )
-        right   = vexControllerGet( Ch4 );
-    else
-        right = 0;
+    // Get controller, deadband is set in vexUserSetup
+    forward = vexControllerShapedGet( Ch3 );
+    right   = vexControllerShapedGet( Ch4 );
 
     if( vexControllerGet( Btn8R ) == 1 )
         turn = 64;
@@ -148,36 +139,8 @@ DriveSystemMecanumDrive( )
     else
         turn = 0;
 
-    // Set drive
-    drive_l_front = forward + turn + right;
-    drive_l_back  = forward + turn - right;
-
-    drive_r_front = forward - turn - right;
-    drive_r_back  = forward - turn + right;
-
-    // normalize drive so max is 127 if any drive is over 127
-    int max = abs(drive_l_front);
-    if (abs(drive_l_back)  > max)
-        max = abs(drive_l_back);
-    if (abs(drive_r_back)  > max)
-        max = abs(drive_r_back);
-    if (abs(drive_r_front) > max)
-        max = abs(drive_r_front);
-    if (max>127) {
-        drive_l_front = 127 * drive_l_front / max;
-        drive_l_back  = 127 * drive_l_back  / max;
-        drive_r_back  = 127 * drive_r_back  / max;
-        drive_r_front = 127 * drive_r_front / max;
-    }
-
-    // Send to motors
-    // left drive
-    SetMotor( MotorLF, drive_l_front);
-    SetMotor( MotorLB, drive_l_back);
-
-    // right drive
-    SetMotor( MotorRF, drive_r_front);
-    SetMotor( MotorRB, drive_r_back);
+    // Mix, normalize and send to motors
+    DriveHolonomic( forward, right, turn );
 }
 
 /*-----------------------------------------------------------------------------*/
@@ -373,12 +336,22 @@ ArmTask(void *arg)
 
 
 
+// Joystick shaping, deadband of 10 and linear response
+static const vexCtlShape joyShape = { 10, 0, 100, FALSE };
+
 // Initialize the digital ports
 void
 vexUserSetup()
 {
 	vexDigitalConfigure( dConfig, DIG_CONFIG_SIZE( dConfig ) );
 	vexMotorConfigure( mConfig, MOT_CONFIG_SIZE( mConfig ) );
+
+    // joystick deadband
+    vexControllerShapeSet( Ch3, &joyShape );
+    vexControllerShapeSet( Ch4, &joyShape );
+
+    // start gyro calibration now so it runs while the master comes online
+    vexGyroInit( kVexAnalog_4 );
 }
 
 // called before either autonomous or user control
@@ -392,10 +365,28 @@ vexUserInit()
 
     SmartMotorLinkMotors( MotorArmR, MotorArmL );
 
+    DriveInit( kDriveMecanum, TRUE );
+    DriveMotorAdd( kDriveLeftFront,  MotorLF );
+    DriveMotorAdd( kDriveLeftBack,   MotorLB );
+    DriveMotorAdd( kDriveRightFront, MotorRF );
+    DriveMotorAdd( kDriveRightBack,  MotorRB );
+
     SmartMotorsSetEncoderGearing( MotorIR, 0.33333333 );
     SmartMotorLinkMotors( MotorIR, MotorIL );
 
     SmartMotorRun();
+
+    // Mecanum odometry, 4" wheels on 393 motors, 627.2 ticks per rev
+    // so 49.9 ticks per inch.  Right side motors are reversed so the
+    // right IMEs count backwards, check this on the robot.  Track is
+    // track width plus wheel base in inches.
+    OdometryInit( kOdometryMecanum, 49.9, 28.0 );
+    OdometryWheelSet( kOdometryLeftFront,  EncLF, FALSE );
+    OdometryWheelSet( kOdometryLeftBack,   EncLB, FALSE );
+    OdometryWheelSet( kOdometryRightFront, EncRF, TRUE  );
+    OdometryWheelSet( kOdometryRightBack,  EncRB, TRUE  );
+    OdometryGyroSet( TRUE, FALSE, 0.25 );
+    OdometryRun();
 }
 
 // Autonomous control task
@@ -417,7 +417,7 @@
  * @note    The default is @p FALSE.
  */
 #if !defined(CH_DBG_FILL_THREADS) || defined(__DOXYGEN__)
-#define CH_DBG_FILL_THREADS             FALSE
+#define CH_DBG_FILL_THREADS             TRUE
 #endif
 
 /**
@@ -448,7 +448,15 @@
  */
 #if !defined(THREAD_EXT_FIELDS) || defined(__DOXYGEN__)
 #define THREAD_EXT_FIELDS                                                   \
-  /* Add threads custom fields here.*/
+  /* Add threads custom fields here.*/                                      \
+  /* cpu cycles used, see vexperf.c */                                      \
+  uint32_t p_cycles;                                                        \
+  /* stack size, see vexstack.c */                                          \
+  uint16_t p_stksize;                                                       \
+  /* task registry slot, see vexcortex.c */                                 \
+  int16_t  p_vexslot;                                                       \
+  /* overran a mode change, see vexcortex.c */                              \
+  uint8_t  p_vexdemote;
 #endif
 
 /**
@@ -461,6 +469,10 @@
 #if !defined(THREAD_EXT_INIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_INIT_HOOK(tp) {                                          \
   /* Add threads initialization code here.*/                                \
+  (tp)->p_cycles = 0;                                                       \
+  (tp)->p_vexslot = -1;                                                     \
+  (tp)->p_vexdemote = FALSE;                                                \
+  vexStackThreadInit( tp );                                                 \
 }
 #endif
 
@@ -475,6 +487,7 @@
 #if !defined(THREAD_EXT_EXIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_EXIT_HOOK(tp) {                                          \
   /* Add threads finalization code here.*/                                  \
+  vexMotorThreadExit( tp );                                                 \
 }
 #endif
 
@@ -485,6 +498,7 @@
 #if !defined(THREAD_CONTEXT_SWITCH_HOOK) || defined(__DOXYGEN__)
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   /* System halt code here.*/                                               \
+  vexPerfContextSwitch( ntp, otp );                                         \
 }
 #endif
 
@@ -506,6 +520,8 @@
 #if !defined(SYSTEM_TICK_EVENT_HOOK) || defined(__DOXYGEN__)
 #define SYSTEM_TICK_EVENT_HOOK() {                                          \
   /* System tick event code here.*/                                         \
+  vexPerfSystemTick();                                                      \
+  vexTaskSystemTick();                                                      \
 }
 #endif
 
@@ -522,6 +538,24 @@
 
 /** @} */
 
+/*===========================================================================*/
+/* ConVEX kernel hooks, see vexperf.c, vexstack.c, vexmotor.c, vexcortex.c.  */
+/*===========================================================================*/
+
+#if !defined(_FROM_ASM_)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void vexPerfContextSwitch( void *ntp, void *otp );
+void vexPerfSystemTick( void );
+void vexTaskSystemTick( void );
+void vexStackThreadInit( void *tp );
+void vexMotorThreadExit( void *tp );
+#ifdef __cplusplus
+}
+#endif
+#endif
+
 /*===========================================================================*/
 /* Port-specific settings (override port settings defaulted in chcore.h).    */
 /*===========================================================================*/